@@ -1,6 +1,5 @@
 #include "Decoder.h"
 #include <iostream>
-#include <chrono>
 
 namespace tof {
 namespace data {
@@ -70,7 +69,8 @@ namespace compressed {
     if (mVerbose)
       std::cout << "-------- START DECODE EVENT ----------------------------------------" << std::endl;
 #endif
-    auto start = std::chrono::high_resolution_clock::now();
+    auto start = mTimer.start();
+    auto sampled = mCounters.start();
 
     clear();
     mByteCounter = 0;
@@ -102,18 +102,21 @@ namespace compressed {
 #endif
 	mUnion++; mByteCounter += 4;
 	
-	auto finish = std::chrono::high_resolution_clock::now();
-	std::chrono::duration<double> elapsed = finish - start;
+#ifdef DECODE_VERBOSE
+	auto elapsed = mTimer.stop(start);
+#else
+	mTimer.stop(start);
+#endif
+	mCounters.stop(sampled, mByteCounter, mSummary.nHits);
 	
 	mIntegratedBytes += mByteCounter;
-	mIntegratedTime += elapsed.count();
 	
 #ifdef DECODE_VERBOSE
 	if (mVerbose)
 	  std::cout << "-------- END DECODE EVENT ------------------------------------------"
 		    << " | " << mByteCounter << " bytes"
-		    << " | " << 1.e3  * elapsed.count() << " ms"
-		    << " | " << 1.e-6 * mIntegratedBytes / mIntegratedTime << " MB/s (average)"
+		    << " | " << 1.e3  * tof::data::raw::Timer::seconds(elapsed) << " ms"
+		    << " | " << 1.e-6 * mIntegratedBytes / mTimer.getTime() << " MB/s (average)"
 		    << std::endl;
 #endif
 	
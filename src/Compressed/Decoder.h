@@ -5,6 +5,8 @@
 #include <string>
 #include <cstdint>
 #include "Compressed/dataFormat.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
 
 namespace tof {
 namespace data {
@@ -27,7 +29,8 @@ namespace compressed {
 
     // benchmarks
     double mIntegratedBytes = 0.;
-    double mIntegratedTime = 0.;
+    tof::data::raw::Timer mTimer;
+    tof::data::raw::Counters mCounters;
     
   protected:
 
@@ -1,6 +1,7 @@
 #include "Encoder.h"
 #include <iostream>
-#include <chrono>
+#include <cstring>
+#include <algorithm>
 
 namespace tof {
 namespace data {
@@ -37,6 +38,22 @@ namespace compressed {
     return false;
   }
   
+  bool
+  Encoder::flush(std::vector<char> &output)
+  {
+#ifdef ENCODE_VERBOSE
+    if (mVerbose) {
+      std::cout << "-------- FLUSH ENCODER BUFFER --------------------------------------"
+		<< " | " << mByteCounter << " bytes"
+		<< std::endl;
+    }
+#endif
+    output.insert(output.end(), mBuffer, mBuffer + mOutputByteCounter);
+    mPointer = (uint32_t *)mBuffer;
+    mOutputByteCounter = 0;
+    return false;
+  }
+  
   bool
   Encoder::close()
   {
@@ -65,6 +82,20 @@ namespace compressed {
     return false;
   }
   
+  void
+  Encoder::reserve(long words)
+  {
+    /** the buffer holds the output not flushed yet and the event so far, it grows when full **/
+    long used = mOutputByteCounter + mByteCounter;
+    if (used + 4 * words <= mSize) return;
+    while (used + 4 * words > mSize) mSize *= 2;
+    auto buffer = new char[mSize];
+    std::memcpy(buffer, mBuffer, used);
+    delete [] mBuffer;
+    mBuffer = buffer;
+    mPointer = (uint32_t *)(mBuffer + used);
+  }
+
   void
   Encoder::next32()
   {
@@ -72,6 +103,48 @@ namespace compressed {
     mByteCounter += 4;
   }
 
+  void
+  Encoder::pair(const uint32_t *hits, int nhits, uint32_t *tot)
+  {
+    /** backwards, with the time of the next trailing hit of each channel **/
+    uint32_t trailing[8];
+    uint32_t open = 0x0;
+    for (int ihit = nhits - 1; ihit >= 0; --ihit) {
+      auto hit = hits[ihit];
+      auto ichan = GET_TDCHIT_CHAN(hit) >> 18;
+      auto HitTime = GET_TDCHIT_HITTIME(hit);
+      switch (GET_TDCHIT_PSBITS(hit)) {
+      case 0x1:
+	tot[ihit] = open & 1 << ichan ? trailing[ichan] - HitTime : 0;
+	break;
+      case 0x2:
+	trailing[ichan] = HitTime;
+	open |= 1 << ichan;
+	break;
+      }
+    }
+  }
+
+  void
+  Encoder::pairScan(const uint32_t *hits, int nhits, uint32_t *tot)
+  {
+    for (int ihit = 0; ihit < nhits; ++ihit) {
+      auto lhit = hits[ihit];
+      if (GET_TDCHIT_PSBITS(lhit) != 0x1)
+	continue; // must be a leading hit
+      auto Chan = GET_TDCHIT_CHAN(lhit);
+      auto HitTime = GET_TDCHIT_HITTIME(lhit);
+      tot[ihit] = 0;
+      for (int jhit = ihit + 1; jhit < nhits; ++jhit) {
+	auto thit = hits[jhit];
+	if (GET_TDCHIT_PSBITS(thit) == 0x2 && GET_TDCHIT_CHAN(thit) == Chan) { // must be a trailing hit from same channel
+	  tot[ihit] = GET_TDCHIT_HITTIME(thit) - HitTime; // compute TOT
+	  break;
+	}
+      }
+    }
+  }
+
   bool
   Encoder::encode(const tof::data::raw::Summary_t &summary)
   {
@@ -81,9 +154,11 @@ namespace compressed {
       std::cout << "-------- START ENCODE EVENT ----------------------------------------" << std::endl;
     }
 #endif
-    auto start = std::chrono::high_resolution_clock::now();	
+    auto start = mTimer.start();
+    auto sampled = mCounters.start();
 
     mByteCounter = 0;
+    reserve(2);
 
     // crate header
     *mPointer  = 0x80000000;
@@ -114,15 +189,21 @@ namespace compressed {
     
     /** loop over TRMs **/
 
-    uint8_t  nPackedHits[256] = {0};
-    uint32_t PackedHit[256][256];
+    /** the packed hits of a TRM in hit order with their frame, then sorted by frame **/
+    auto nhitsMax = summary.TDCUnpackedHit.size();
+    if (mPacked.size() < nhitsMax) {
+      mPacked.resize(nhitsMax);
+      mFrameID.resize(nhitsMax);
+      mSorted.resize(nhitsMax);
+    }
+    uint32_t nPackedHits[256] = {0};
     for (int itrm = 0; itrm < 10; itrm++) {
 
       /** check if TRM is empty **/
       if (summary.TRMempty[itrm]) continue;
 
-      uint8_t firstFilledFrame = 255;
-      uint8_t lastFilledFrame = 0;
+      uint64_t filledFrames[4] = {0};
+      uint32_t npacked = 0;
 
       /** SPIDER **/
       
@@ -135,94 +216,107 @@ namespace compressed {
           auto nhits = summary.nTDCUnpackedHits[itrm][ichain][itdc];
           if (nhits == 0)
             continue;
+	  auto hits = &summary.TDCUnpackedHit[summary.TDCUnpackedHitOffset[itrm][ichain][itdc]];
+
+	  /** pair leading and trailing hits, a trailing hit can close more leading hits **/
+	  if (mTOT.size() < nhits) mTOT.resize(nhits);
+	  auto tot = mTOT.data();
+	  pair(hits, nhits, tot);
 
           /** loop over hits **/
-          for (int ihit = 0; ihit < nhits; ++ihit) {
+          for (uint32_t ihit = 0; ihit < nhits; ++ihit) {
 
-            auto lhit = summary.TDCUnpackedHit[itrm][ichain][itdc][ihit];
+            auto lhit = hits[ihit];
             if (GET_TDCHIT_PSBITS(lhit) != 0x1)
               continue; // must be a leading hit
 
 	    auto Chan = GET_TDCHIT_CHAN(lhit);
 	    auto HitTime = GET_TDCHIT_HITTIME(lhit);
-	    auto EBit = GET_TDCHIT_EBIT(lhit);
-            uint32_t TOTWidth = 0;
-	    
-            // check next hits for packing
-            for (int jhit = ihit + 1; jhit < nhits; ++jhit) {
-              auto thit = summary.TDCUnpackedHit[itrm][ichain][itdc][jhit];
-              if (GET_TDCHIT_PSBITS(thit) == 0x2 && GET_TDCHIT_CHAN(thit) == Chan) { // must be a trailing hit from same channel
-                TOTWidth = GET_TDCHIT_HITTIME(thit) - HitTime; // compute TOT
-                lhit = 0x0; // mark as used
-                break;
-              }
-            }
+            uint32_t TOTWidth = tot[ihit];
 
 	    auto iframe = HitTime >> 13;
-	    auto phit = nPackedHits[iframe];
 
-	    PackedHit[iframe][phit]  = 0x00000000;
-	    PackedHit[iframe][phit] |= TOTWidth;
-	    PackedHit[iframe][phit] |= HitTime << 11;
-	    PackedHit[iframe][phit] |= Chan << 24;
-	    PackedHit[iframe][phit] |= itdc << 27;
-	    PackedHit[iframe][phit] |= ichain << 31;
+	    mPacked[npacked]  = 0x00000000;
+	    mPacked[npacked] |= TOTWidth;
+	    mPacked[npacked] |= HitTime << 11;
+	    mPacked[npacked] |= Chan << 24;
+	    mPacked[npacked] |= itdc << 27;
+	    mPacked[npacked] |= ichain << 31;
+	    mFrameID[npacked] = iframe;
+	    npacked++;
 	    nPackedHits[iframe]++;
 	    
-	    if (iframe < firstFilledFrame)
-	      firstFilledFrame = iframe;
-	    if (iframe > lastFilledFrame)
-	      lastFilledFrame = iframe;
+	    filledFrames[iframe >> 6] |= 1ull << (iframe & 63);
 	    
 	  }
 	}
       }
             
-      /** loop over frames **/
-      for (int iframe = firstFilledFrame; iframe < lastFilledFrame + 1; iframe++) {
+      /** counting sort by frame, the hits of a frame keep their order **/
+      uint32_t position[256];
+      uint32_t nwords = npacked + 1;
+      for (int iword = 0, sum = 0; iword < 4; ++iword) {
+	for (auto filled = filledFrames[iword]; filled; filled &= filled - 1) {
+	  int iframe = iword << 6 | __builtin_ctzll(filled);
+	  position[iframe] = sum;
+	  sum += nPackedHits[iframe];
+	  nwords += (nPackedHits[iframe] + 0xfffe) / 0xffff;
+	}
+      }
+      auto sorted = mSorted.data();
+      for (uint32_t ihit = 0; ihit < npacked; ++ihit)
+	sorted[position[mFrameID[ihit]]++] = mPacked[ihit];
+      reserve(nwords);
 
-        /** check if frame is empty **/
-        if (nPackedHits[iframe] == 0)
-          continue;
+      /** loop over filled frames **/
+      for (int iword = 0; iword < 4; ++iword) {
+	for (auto filled = filledFrames[iword]; filled; filled &= filled - 1) {
+	  int iframe = iword << 6 | __builtin_ctzll(filled);
 
-        // frame header
-	*mPointer  = 0x00000000;
-	*mPointer |= (itrm + 3) << 24;
-	*mPointer |= iframe << 16;
-        *mPointer |= nPackedHits[iframe];
+	  /** a frame with more hits than a header can count takes more headers **/
+	  while (nPackedHits[iframe] > 0) {
+	    uint32_t nhits = std::min(nPackedHits[iframe], 0xffffu);
+	    nPackedHits[iframe] -= nhits;
+
+	    // frame header
+	    *mPointer  = 0x00000000;
+	    *mPointer |= (itrm + 3) << 24;
+	    *mPointer |= iframe << 16;
+	    *mPointer |= nhits;
 #ifdef ENCODE_VERBOSE
-	if (mVerbose) {
-	  auto FrameHeader = reinterpret_cast<FrameHeader_t *>(mPointer);
-	  auto NumberOfHits = FrameHeader->NumberOfHits;
-	  auto FrameID = FrameHeader->FrameID;
-	  auto TRMID = FrameHeader->TRMID;
-	  printf(" %08x Frame header          (TRMID=%d, FrameID=%d, NumberOfHits=%d) \n", *mPointer, TRMID, FrameID, NumberOfHits);
-	}
+	    if (mVerbose) {
+	      auto FrameHeader = reinterpret_cast<FrameHeader_t *>(mPointer);
+	      auto NumberOfHits = FrameHeader->NumberOfHits;
+	      auto FrameID = FrameHeader->FrameID;
+	      auto TRMID = FrameHeader->TRMID;
+	      printf(" %08x Frame header          (TRMID=%d, FrameID=%d, NumberOfHits=%d) \n", *mPointer, TRMID, FrameID, NumberOfHits);
+	    }
 #endif
-	next32();
+	    next32();
 	
-	// packed hits
-        for (int ihit = 0; ihit < nPackedHits[iframe]; ++ihit) {
-	  *mPointer = PackedHit[iframe][ihit];
+	    // packed hits
+	    for (uint32_t ihit = 0; ihit < nhits; ++ihit) {
+	      *mPointer = *sorted++;
 #ifdef ENCODE_VERBOSE
-	  if (mVerbose) {
-	    auto PackedHit = reinterpret_cast<PackedHit_t *>(mPointer);
-            auto Chain = PackedHit->Chain;
-            auto TDCID = PackedHit->TDCID;
-            auto Channel = PackedHit->Channel;
-            auto Time = PackedHit->Time;
-            auto TOT = PackedHit->TOT;
-            printf(" %08x Packed hit            (Chain=%d, TDCID=%d, Channel=%d, Time=%d, TOT=%d) \n", *mPointer, Chain, TDCID, Channel, Time, TOT);
-          }
+	      if (mVerbose) {
+		auto PackedHit = reinterpret_cast<PackedHit_t *>(mPointer);
+		auto Chain = PackedHit->Chain;
+		auto TDCID = PackedHit->TDCID;
+		auto Channel = PackedHit->Channel;
+		auto Time = PackedHit->Time;
+		auto TOT = PackedHit->TOT;
+		printf(" %08x Packed hit            (Chain=%d, TDCID=%d, Channel=%d, Time=%d, TOT=%d) \n", *mPointer, Chain, TDCID, Channel, Time, TOT);
+	      }
 #endif
-	  next32();
-        }
-
-        nPackedHits[iframe] = 0;
+	      next32();
+	    }
+	  }
+	}
       }
     }
 
     // crate trailer
+    reserve(1);
     *mPointer = 0x80000000 | summary.faultFlags;
 #ifdef ENCODE_VERBOSE
     if (mVerbose) {
@@ -244,19 +338,22 @@ namespace compressed {
 #endif
     next32();
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
+#ifdef ENCODE_VERBOSE
+    auto elapsed = mTimer.stop(start);
+#else
+    mTimer.stop(start);
+#endif
+    mCounters.stop(sampled, mByteCounter, summary.TDCUnpackedHit.size());
 
     mOutputByteCounter += mByteCounter;
     mIntegratedBytes += mByteCounter;
-    mIntegratedTime += elapsed.count();
     
 #ifdef ENCODE_VERBOSE
     if (mVerbose) {
       std::cout << "-------- END ENCODE EVENT ------------------------------------------"
 		<< " | " << mByteCounter << " bytes"
-		<< " | " << 1.e3  * elapsed.count() << " ms"
-		<< " | " << 1.e-6 * mIntegratedBytes / mIntegratedTime << " MB/s (average)"
+		<< " | " << 1.e3  * tof::data::raw::Timer::seconds(elapsed) << " ms"
+		<< " | " << 1.e-6 * mIntegratedBytes / mTimer.getTime() << " MB/s (average)"
 		<< std::endl;
     }
 #endif
@@ -4,8 +4,11 @@
 #include <fstream>
 #include <string>
 #include <cstdint>
+#include <vector>
 #include "Raw/dataFormat.h"
 #include "Compressed/dataFormat.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
 
 namespace tof {
 namespace data {
@@ -16,32 +19,47 @@ namespace compressed {
   public:
     
     Encoder() : mVerbose(false) {};
-    ~Encoder() {};
+    ~Encoder() { delete [] mBuffer; };
     
     bool open(std::string name);
     bool init();
     bool encode(const tof::data::raw::Summary_t &summary);
     bool flush();
+    /** append the buffer to output instead of writing the file **/
+    bool flush(std::vector<char> &output);
     bool close();
     void setVerbose(bool val) {mVerbose = val;};
+
+    /** TOT of each leading hit of a TDC with the first trailing hit of its channel
+        after it, 0 if none, in one sweep, other hits are left untouched **/
+    static void pair(const uint32_t *hits, int nhits, uint32_t *tot);
+    /** reference, a scan of the following hits for each leading hit **/
+    static void pairScan(const uint32_t *hits, int nhits, uint32_t *tot);
     
     // benchmarks
     double mIntegratedBytes = 0.;
-    double mIntegratedTime = 0.;
+    tof::data::raw::Timer mTimer;
+    tof::data::raw::Counters mCounters;
     
   protected:
 
     inline void next32();
+    /** room for words more in the buffer **/
+    void reserve(long words);
 
     std::ofstream mFile;
     bool mVerbose;
 
-    char *mBuffer;
+    char *mBuffer = nullptr;
     long mSize = 8192;
     uint32_t *mPointer = nullptr;
 
     uint32_t mOutputByteCounter = 0;
     uint32_t mByteCounter = 0;
+    std::vector<uint32_t> mTOT;     // of the hits of a TDC
+    std::vector<uint32_t> mPacked;  // of a TRM, in hit order
+    std::vector<uint8_t>  mFrameID; // of the packed hits
+    std::vector<uint32_t> mSorted;  // of a TRM, by frame
   };
   
 }}}
@@ -0,0 +1,154 @@
+#include "AsyncSource.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  AsyncSource::AsyncSource(long size, int depth) :
+    mBlock(size)
+  {
+    if (depth < 1) depth = 1;
+    mCapacity = mBlock * depth;
+    if (mCapacity < 2 * mSlack) mCapacity = 2 * mSlack;
+    /** slack after the ring keeps a straddling peek contiguous **/
+    mBuffer = new char[mCapacity + mSlack];
+  }
+  
+  bool
+  AsyncSource::open(std::string name)
+  {
+    if (mFD >= 0) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      close();
+    }
+    int fd = openStream(name);
+    if (fd < 0) return true;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return start(fd);
+  }
+
+  bool
+  AsyncSource::start(int fd)
+  {
+    if (pipe(mWake) != 0) {
+      std::cerr << "Cannot create wake-up pipe" << std::endl;
+      if (fd != STDIN_FILENO) ::close(fd);
+      return true;
+    }
+    mFD = fd;
+    mHead = mCount = 0;
+    mEOF = mStop = false;
+    mError = 0;
+    mThread = std::thread(&AsyncSource::loop, this);
+    return false;
+  }
+  
+  bool
+  AsyncSource::close()
+  {
+    if (mFD < 0) return true;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mDrained.notify_all();
+    /** wake the reader if it waits on the input **/
+    char byte = 0;
+    while (::write(mWake[1], &byte, 1) < 0 && errno == EINTR);
+    if (mThread.joinable()) mThread.join();
+    if (mFD != STDIN_FILENO) ::close(mFD);
+    ::close(mWake[0]);
+    ::close(mWake[1]);
+    mFD = mWake[0] = mWake[1] = -1;
+    return false;
+  }
+
+  void
+  AsyncSource::loop()
+  {
+    while (true) {
+
+      /** wait for a free block **/
+      long tail, size;
+      {
+	std::unique_lock<std::mutex> lock(mMutex);
+	mDrained.wait(lock, [this] { return mStop || mCapacity - mCount >= mBlock; });
+	if (mStop) return;
+	tail = (mHead + mCount) % mCapacity;
+	size = mBlock;
+	if (size > mCapacity - tail) size = mCapacity - tail;
+      }
+
+      /** wait for data or for close, then fill it outside the lock **/
+      struct pollfd fds[2] = {{mFD, POLLIN, 0}, {mWake[0], POLLIN, 0}};
+      if (poll(fds, 2, -1) < 0) {
+	if (errno == EINTR) continue;
+	std::lock_guard<std::mutex> lock(mMutex);
+	mError = errno;
+	mEOF = true;
+	mFilled.notify_one();
+	return;
+      }
+      if (fds[1].revents) return;
+      long nbytes = ::read(mFD, mBuffer + tail, size);
+      if (nbytes < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+      
+      {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (nbytes > 0) mCount += nbytes;
+	else mEOF = true;
+	if (nbytes < 0) mError = errno;
+      }
+      mFilled.notify_one();
+      if (nbytes <= 0) return;
+    }
+  }
+  
+  char *
+  AsyncSource::peek(long size)
+  {
+    if (size > mSlack) {
+      std::cout << "Warning: peek request exceeds read-ahead slack" << std::endl;
+      return nullptr;
+    }
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFilled.wait(lock, [this, size] { return mEOF || mCount >= size; });
+    if (mCount < size) {
+      if (mError) std::cerr << "Cannot read input: " << std::strerror(mError) << std::endl;
+      return nullptr;
+    }
+    /** wrap-around: mirror the head of the ring into the slack **/
+    if (mHead + size > mCapacity)
+      std::memcpy(mBuffer + mCapacity, mBuffer, mHead + size - mCapacity);
+    return mBuffer + mHead;
+  }
+
+  bool
+  AsyncSource::isBad() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mError != 0;
+  }
+
+  bool
+  AsyncSource::consume(long size)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (size > mCount) return true;
+      mHead = (mHead + size) % mCapacity;
+      mCount -= size;
+    }
+    mDrained.notify_one();
+    return false;
+  }
+
+}}}
@@ -0,0 +1,61 @@
+#ifndef _TOF_RAW_DATA_ASYNCSOURCE_H
+#define _TOF_RAW_DATA_ASYNCSOURCE_H
+
+#include <string>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Raw/Source.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** read-ahead page source, a reader thread keeps depth blocks in flight,
+      works on files as well as on streaming inputs. The reader waits in poll
+      on the input and on a wake-up pipe, close() does not hang on a stalled
+      writer **/
+
+  class AsyncSource : public Source {
+
+  public:
+
+    AsyncSource(long size = 8192, int depth = 4);
+    ~AsyncSource() { close(); delete [] mBuffer; };
+
+    bool open(std::string name);
+    bool close();
+    bool isOpen() const {return mFD >= 0;};
+    bool isBad() const;
+    char *peek(long size);
+    bool consume(long size);
+
+  protected:
+
+    bool start(int fd);
+    void loop();
+
+    static const long mSlack = 65536;
+
+    int mFD = -1;
+    int mWake[2] = {-1, -1};
+    std::thread mThread;
+    mutable std::mutex mMutex;
+    std::condition_variable mFilled;
+    std::condition_variable mDrained;
+
+    char *mBuffer = nullptr;
+    long mBlock;
+    long mCapacity;
+    long mHead = 0;
+    long mCount = 0;
+    bool mEOF = false;
+    bool mStop = false;
+    int mError = 0;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_ASYNCSOURCE_H **/
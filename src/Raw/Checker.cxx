@@ -1,17 +1,242 @@
 #include "Checker.h"
 #include <iostream>
-#include <chrono>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 namespace tof {
 namespace data {
 namespace raw {
 
+  /** bit i set where (words[i] & mask) == value **/
+  template <int N>
+  static inline uint32_t
+  matchMask(const uint32_t *words, uint32_t mask, uint32_t value)
+  {
+    uint32_t bits = 0x0;
+    int i = 0;
+#ifdef __AVX2__
+    const __m256i m8 = _mm256_set1_epi32(mask), v8 = _mm256_set1_epi32(value);
+    for (; i + 8 <= N; i += 8) {
+      __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+      bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(w, m8), v8))) << i;
+    }
+    /** the last words with a load overlapping the previous one **/
+    if (N > 8 && i < N) {
+      __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + N - 8));
+      bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(w, m8), v8))) << (N - 8);
+      i = N;
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i m4 = _mm_set1_epi32(mask), v4 = _mm_set1_epi32(value);
+    for (; i + 4 <= N; i += 4) {
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + i));
+      bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w, m4), v4))) << i;
+    }
+    if (N > 4 && i < N) {
+      __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + N - 4));
+      bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(w, m4), v4))) << (N - 4);
+      i = N;
+    }
+#endif
+    for (; i < N; ++i)
+      bits |= (uint32_t)((words[i] & mask) == value) << i;
+    return bits;
+  }
+
+  /** bit i set where (a[i] & mask) >> S == b[i] **/
+  template <int N, int S>
+  static inline uint32_t
+  matchPair(const uint32_t *a, uint32_t mask, const uint32_t *b)
+  {
+    uint32_t bits = 0x0;
+    int i = 0;
+#ifdef __AVX2__
+    const __m256i m8 = _mm256_set1_epi32(mask);
+    for (; i + 8 <= N; i += 8) {
+      __m256i x = _mm256_srli_epi32(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)), m8), S);
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+      bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y))) << i;
+    }
+    if (N > 8 && i < N) {
+      __m256i x = _mm256_srli_epi32(_mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + N - 8)), m8), S);
+      __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + N - 8));
+      bits |= (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(x, y))) << (N - 8);
+      i = N;
+    }
+#endif
+#ifdef __SSE2__
+    const __m128i m4 = _mm_set1_epi32(mask);
+    for (; i + 4 <= N; i += 4) {
+      __m128i x = _mm_srli_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), m4), S);
+      __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+      bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y))) << i;
+    }
+    if (N > 4 && i < N) {
+      __m128i x = _mm_srli_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + N - 4)), m4), S);
+      __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + N - 4));
+      bits |= (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y))) << (N - 4);
+      i = N;
+    }
+#endif
+    for (; i < N; ++i)
+      bits |= (uint32_t)(((a[i] & mask) >> S) == b[i]) << i;
+    return bits;
+  }
+
+  /** bit i to bit 2i **/
+  static inline uint32_t
+  spread2(uint32_t x)
+  {
+    x = (x | x << 8) & 0x00ff00ff;
+    x = (x | x << 4) & 0x0f0f0f0f;
+    x = (x | x << 2) & 0x33333333;
+    x = (x | x << 1) & 0x55555555;
+    return x;
+  }
+
+  /** bit 2i to bit i **/
+  static inline uint32_t
+  compact2(uint32_t x)
+  {
+    x &= 0x55555555;
+    x = (x | x >> 1) & 0x33333333;
+    x = (x | x >> 2) & 0x0f0f0f0f;
+    x = (x | x >> 4) & 0x00ff00ff;
+    x = (x | x >> 8) & 0x0000ffff;
+    return x;
+  }
+
+  /** bit i to bit 3i, 10 bits **/
+  static inline uint32_t
+  spread3(uint32_t x)
+  {
+    x &= 0x3ff;
+    x = (x | x << 16) & 0x030000ff;
+    x = (x | x << 8) & 0x0300f00f;
+    x = (x | x << 4) & 0x030c30c3;
+    x = (x | x << 2) & 0x09249249;
+    return x;
+  }
+
+  bool
+  Checker::compose(const Masks_t &masks, uint32_t &faultFlags)
+  {
+    /** TRMs: flagged if not participating, bad if missing header or trailer or the event number is off **/
+    uint32_t absent = masks.Selected & ~masks.Participating;
+    uint32_t present = masks.Selected & masks.Participating;
+    uint32_t trmBad = present & ~(masks.TRMHeader & masks.TRMTrailer & ~(masks.TRMEventCounter | masks.TRMIntegrity));
+
+    /** chains are checked for the good TRMs only **/
+    uint32_t chains = spread2(present & ~trmBad);
+    chains |= chains << 1;
+    uint32_t chainBad = chains & (~(masks.ChainHeader & masks.ChainTrailer) | masks.ChainEventCounter | masks.ChainStatus | masks.ChainBunchID);
+
+    /** bit 1 + 3 * itrm for the TRM, the next two for its chains **/
+    faultFlags |= spread3(absent | trmBad) << 1 | spread3(compact2(chainBad)) << 2 | spread3(compact2(chainBad >> 1)) << 3;
+    return (absent & masks.TRMHeader) | trmBad | chainBad;
+  }
+
+  /** one more for each bit set **/
+  template <typename T>
+  static inline void
+  countBits(uint32_t bits, T *data, uint32_t T::*counter)
+  {
+    for (; bits; bits &= bits - 1)
+      (data[__builtin_ctz(bits)].*counter)++;
+  }
+
+  void
+  Checker::count(const Masks_t &masks, bool drmEventWords, CrateCounterData_t &crate)
+  {
+    crate.DRM.ExpectedData++;
+    crate.DRM.DetectedData++;
+    crate.DRM.EventWordsMismatch += drmEventWords;
+
+    /** the participating TRMs, the mismatches of those with header and trailer **/
+    uint32_t expected = masks.Selected & masks.Participating;
+    uint32_t detected = expected & masks.TRMHeader & masks.TRMTrailer;
+    countBits(expected, crate.TRM, &TRMCounterData_t::ExpectedData);
+    countBits(detected, crate.TRM, &TRMCounterData_t::DetectedData);
+    countBits(detected & masks.TRMEventCounter, crate.TRM, &TRMCounterData_t::EventCounterMismatch);
+    countBits(detected & masks.TRMIntegrity, crate.TRM, &TRMCounterData_t::EventWordsMismatch);
+
+    /** the chains of the good TRMs, as the checks **/
+    uint32_t chains = spread2(detected & ~(masks.TRMEventCounter | masks.TRMIntegrity));
+    chains |= chains << 1;
+    uint32_t chainDetected = chains & masks.ChainHeader & masks.ChainTrailer;
+    auto chain = &crate.TRMChain[0][0];
+    countBits(chains, chain, &TRMChainCounterData_t::ExpectedData);
+    countBits(chainDetected, chain, &TRMChainCounterData_t::DetectedData);
+    countBits(chainDetected & masks.ChainEventCounter, chain, &TRMChainCounterData_t::EventCounterMismatch);
+    /** status and bunch ID are not looked at past an event counter mismatch **/
+    uint32_t chainCounted = chainDetected & ~masks.ChainEventCounter;
+    countBits(chainCounted & masks.ChainStatus, chain, &TRMChainCounterData_t::BadStatus);
+    countBits(chainCounted & masks.ChainBunchID, chain, &TRMChainCounterData_t::BunchIDMismatch);
+  }
+
   bool
   Checker::check(tof::data::raw::Summary_t &summary)
+  {
+#ifdef CHECK_VERBOSE
+    if (mVerbose) return checkScalar(summary);
+#endif
+
+    auto start = mTimer.start();
+    auto sampled = mCounters.start();
+
+    /** DRM Global Header and Trailer, nothing else is checked without them **/
+    if (summary.DRMGlobalHeader == 0x0 || summary.DRMGlobalTrailer == 0x0) {
+      summary.faultFlags |= 1;
+      /** missed by its crate, crate 0 without the global header **/
+      if (mFillStatistics) mStatistics.getCrate(GET_DRM_DRMID(summary.DRMGlobalHeader)).DRM.ExpectedData++;
+      mTimer.stop(start);
+      mCounters.stop(sampled, 0, summary.TDCUnpackedHit.size());
+      return true;
+    }
+
+    uint32_t L0BCID            = GET_DRM_L0BCID(summary.DRMStatusHeader3);
+    uint32_t LocalEventCounter = GET_DRM_LOCALEVENTCOUNTER(summary.DRMGlobalTrailer);
+
+    /** all TRM and chain words at once, missing words are zero **/
+    auto chainHeader = &summary.TRMChainHeader[0][0];
+    auto chainTrailer = &summary.TRMChainTrailer[0][0];
+    Masks_t masks;
+    masks.Selected          = mSlotMask >> 1 & 0x3ff;
+    masks.Participating     = GET_DRM_PARTICIPATINGSLOTID(summary.DRMStatusHeader1) >> 1 & 0x3ff;
+    masks.TRMHeader         = ~matchMask<10>(summary.TRMGlobalHeader, 0xffffffff, 0x0) & 0x3ff;
+    masks.TRMTrailer        = ~matchMask<10>(summary.TRMGlobalTrailer, 0xffffffff, 0x0) & 0x3ff;
+    masks.TRMEventCounter   = ~matchMask<10>(summary.TRMGlobalHeader, 0x07FE0000, (LocalEventCounter % 1024) << 17) & 0x3ff;
+    masks.TRMIntegrity      = mIntegrity ? ~matchPair<10, 4>(summary.TRMGlobalHeader, 0x0001FFF0, summary.TRMEventWords) & 0x3ff : 0x0;
+    masks.ChainHeader       = ~matchMask<20>(chainHeader, 0xffffffff, 0x0) & 0xfffff;
+    masks.ChainTrailer      = ~matchMask<20>(chainTrailer, 0xffffffff, 0x0) & 0xfffff;
+    masks.ChainEventCounter = ~matchMask<20>(chainTrailer, 0x0FFF0000, LocalEventCounter << 16) & 0xfffff;
+    masks.ChainStatus       = ~matchMask<20>(chainTrailer, 0x0000000F, 0x0) & 0xfffff;
+    masks.ChainBunchID      = ~matchMask<20>(chainHeader, 0x0000FFF0, L0BCID << 4) & 0xfffff;
+    bool status = compose(masks, summary.faultFlags);
+
+    /** DRM EventWords off, the TRMs are still checked **/
+    bool drmEventWords = mIntegrity && summary.DRMEventWords != GET_DRM_EVENTWORDS(summary.DRMGlobalHeader);
+    if (drmEventWords) {
+      summary.faultFlags |= 1;
+      status = true;
+    }
+    if (mFillStatistics) count(masks, drmEventWords, mStatistics.getCrate(GET_DRM_DRMID(summary.DRMGlobalHeader)));
+
+    mTimer.stop(start);
+    mCounters.stop(sampled, 0, summary.TDCUnpackedHit.size());
+    
+    return status;
+  }
+
+  bool
+  Checker::checkScalar(tof::data::raw::Summary_t &summary)
   {
     bool status = false;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    auto start = mTimer.start();
+    auto sampled = mCounters.start();
 
     
 #ifdef CHECK_VERBOSE
@@ -44,6 +269,17 @@ namespace raw {
       return status;
     }
 
+    /** check DRM EventWords **/
+    if (mIntegrity && summary.DRMEventWords != GET_DRM_EVENTWORDS(summary.DRMGlobalHeader)) {
+      status = true;
+      summary.faultFlags |= 1;
+#ifdef CHECK_VERBOSE
+      if (mVerbose) {
+	printf(" DRM EventWords mismatch: %d / %d \n", summary.DRMEventWords, GET_DRM_EVENTWORDS(summary.DRMGlobalHeader));
+      }
+#endif
+    }
+
     /** get DRM relevant data **/
     uint32_t ParticipatingSlotID = GET_DRM_PARTICIPATINGSLOTID(summary.DRMStatusHeader1);
     uint32_t SlotEnableMask      = GET_DRM_SLOTENABLEMASK(summary.DRMStatusHeader2);
@@ -60,9 +296,14 @@ namespace raw {
     
     /** loop over TRMs **/
     for (int itrm = 0; itrm < 10; ++itrm) {
+#ifdef CHECK_VERBOSE
       uint32_t SlotID = itrm + 3;
+#endif
       uint32_t trmFaultBit = 1 << (1 + itrm * 3);
       
+      /** not decoded **/
+      if (!(mSlotMask & 1 << (itrm + 1))) continue;
+
       /** check participating TRM **/
       if (!(ParticipatingSlotID & 1 << (itrm + 1))) {
 	if (summary.TRMGlobalHeader[itrm] != 0x0) {
@@ -113,6 +354,21 @@ namespace raw {
 #endif
 	continue;
       }
+
+      /** check TRM EventWords **/
+      if (mIntegrity) {
+	uint32_t EventWords = GET_TRM_EVENTWORDS(summary.TRMGlobalHeader[itrm]);
+	if (summary.TRMEventWords[itrm] != EventWords) {
+	  status = true;
+	  summary.faultFlags |= trmFaultBit;
+#ifdef CHECK_VERBOSE
+	  if (mVerbose) {
+	    printf(" TRM EventWords mismatch: %d / %d (SlotID=%d) \n", summary.TRMEventWords[itrm], EventWords, SlotID);
+	  }
+#endif
+	  continue;
+	}
+      }
       
       /** loop over TRM chains **/
       for (int ichain = 0; ichain < 2; ichain++) {
@@ -183,10 +439,8 @@ namespace raw {
       } /** end of loop over TRM chains **/
     } /** end of loop over TRMs **/
 
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-
-    mIntegratedTime += elapsed.count();
+    mTimer.stop(start);
+    mCounters.stop(sampled, 0, summary.TDCUnpackedHit.size());
     
     return status;
   }
@@ -5,11 +5,17 @@
 #include <string>
 #include <cstdint>
 #include "Raw/dataFormat.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
+#include "Raw/Statistics.h"
 
 namespace tof {
 namespace data {
 namespace raw {
   
+  /** consistency checks on a decoded Summary_t, the decoder runs the same
+      checks inline with Decoder::setCheck, this one re-checks stored summaries **/
+  
   class Checker {
 
   public:
@@ -17,15 +23,49 @@ namespace raw {
     Checker() {};
     ~Checker() {};
 
+    /** vectorised over TRMs and chains, the scalar path when verbose **/
     bool check(tof::data::raw::Summary_t &summary);
+    /** reference, TRM by TRM and chain by chain, prints the faults with CHECK_VERBOSE **/
+    bool checkScalar(tof::data::raw::Summary_t &summary);
     void setVerbose(bool val) {mVerbose = val;};
+    /** check only the slots the decoder was asked for (bit SlotID - 2) **/
+    void setSlotMask(uint32_t val) {mSlotMask = val;};
+    /** check EventWords against the decoder, which must run with Decoder::setIntegrity **/
+    void setIntegrity(bool val) {mIntegrity = val;};
+    /** count the faults by crate, TRM and chain over the run, not in verbose mode **/
+    void setStatistics(bool val) {mFillStatistics = val;};
+    Statistics &getStatistics() {return mStatistics;};
+
+    /** TRM (bit itrm) and chain (bit 2 * itrm + ichain) masks of an event **/
+    struct Masks_t {
+      uint32_t Selected;      // TRMs to check
+      uint32_t Participating; // DRM ParticipatingSlotID
+      uint32_t TRMHeader;     // present
+      uint32_t TRMTrailer;    // present
+      uint32_t TRMEventCounter;   // EventNumber != LocalEventCounter % 1024
+      uint32_t TRMIntegrity;      // EventWords off
+      uint32_t ChainHeader;       // present
+      uint32_t ChainTrailer;      // present
+      uint32_t ChainEventCounter; // EventCounter != LocalEventCounter
+      uint32_t ChainStatus;       // Status != 0
+      uint32_t ChainBunchID;      // BunchID != L0BCID
+    };
+    /** fault flags from the masks with no branches, true if the event is bad **/
+    static bool compose(const Masks_t &masks, uint32_t &faultFlags);
+    /** add an event with DRM header and trailer to the run counters of its crate **/
+    static void count(const Masks_t &masks, bool drmEventWords, CrateCounterData_t &crate);
 
     // benchmarks
-    double mIntegratedTime = 0.;
+    Timer mTimer;
+    Counters mCounters;
     
   protected:
 
     bool mVerbose = false;
+    uint32_t mSlotMask = 0x7ff;
+    bool mIntegrity = false;
+    bool mFillStatistics = false;
+    Statistics mStatistics;
     
   };
   
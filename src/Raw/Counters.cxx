@@ -0,0 +1,181 @@
+#include "Counters.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  uint32_t Counters::mDefaultSampling = 0;
+
+  Counters &
+  Counters::operator=(const Counters &other)
+  {
+    if (this == &other) return *this;
+    close();
+    mSampling = other.mSampling;
+    mCalls = other.mCalls;
+    mSamples = other.mSamples;
+    mBytes = other.mBytes;
+    mHits = other.mHits;
+    for (int i = 0; i < Event_N; ++i) {
+      mAvailable[i] = other.mAvailable[i];
+      mValues[i] = other.mValues[i];
+    }
+    return *this;
+  }
+
+  const char *
+  Counters::getName(EEvent_t event)
+  {
+    static const char *names[Event_N] = {"cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses", "dTLB-misses"};
+    return names[event];
+  }
+
+  bool
+  Counters::open()
+  {
+#ifdef __linux__
+    static const uint32_t type[Event_N] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+    };
+    static const uint64_t config[Event_N] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+      PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16,
+      PERF_COUNT_HW_CACHE_DTLB | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16
+    };
+
+    /** one group, read in a single call, the first event that opens leads **/
+    int leader = -1;
+    for (int i = 0; i < Event_N; ++i) {
+      struct perf_event_attr attr;
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = type[i];
+      attr.config = config[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      mFd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+      mAvailable[i] = mFd[i] >= 0;
+      if (!mAvailable[i]) continue;
+      if (leader < 0) leader = mFd[i];
+      mNOpen++;
+    }
+    mOpen = leader >= 0;
+#endif
+    if (mOpen) return false;
+
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true))
+      std::cout << "Warning: hardware counters not available, disabled" << std::endl;
+    return true;
+  }
+
+  void
+  Counters::close()
+  {
+#ifdef __linux__
+    for (int i = 0; i < Event_N; ++i) {
+      if (mFd[i] >= 0) ::close(mFd[i]);
+      mFd[i] = -1;
+    }
+#endif
+    mOpen = false;
+    mNOpen = 0;
+  }
+
+  bool
+  Counters::read(Reading_t &reading)
+  {
+    if (!mOpen && open()) {
+      mSampling = 0;
+      return true;
+    }
+#ifdef __linux__
+    uint64_t buffer[3 + Event_N];
+    auto size = (3 + mNOpen) * sizeof(uint64_t);
+    int leader = 0;
+    while (mFd[leader] < 0) leader++;
+    if (::read(mFd[leader], buffer, size) != (ssize_t)size) return true;
+    reading.Enabled = buffer[1];
+    reading.Running = buffer[2];
+    for (int i = 0, j = 3; i < Event_N; ++i)
+      reading.Values[i] = mAvailable[i] ? buffer[j++] : 0;
+    return false;
+#else
+    return true;
+#endif
+  }
+
+  void
+  Counters::accumulate(uint64_t bytes, uint64_t hits)
+  {
+    Reading_t end;
+    if (read(end)) return;
+    /** scale up if the group was multiplexed with others **/
+    double running = end.Running - mStart.Running;
+    double scale = running > 0. ? (end.Enabled - mStart.Enabled) / running : 1.;
+    for (int i = 0; i < Event_N; ++i)
+      mValues[i] += scale * (end.Values[i] - mStart.Values[i]);
+    mSamples++;
+    mBytes += bytes;
+    mHits += hits;
+  }
+
+  void
+  Counters::merge(const Counters &other)
+  {
+    mCalls += other.mCalls;
+    mSamples += other.mSamples;
+    mBytes += other.mBytes;
+    mHits += other.mHits;
+    for (int i = 0; i < Event_N; ++i) {
+      mAvailable[i] |= other.mAvailable[i];
+      mValues[i] += other.mValues[i];
+    }
+  }
+
+  void
+  Counters::reset()
+  {
+    mCalls = mSamples = mBytes = mHits = 0;
+    for (int i = 0; i < Event_N; ++i)
+      mValues[i] = 0.;
+  }
+
+  std::string
+  Counters::summary() const
+  {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(3);
+    if (!mSamples) {
+      out << "not sampled";
+      return out.str();
+    }
+    for (int i = 0; i < Event_N; ++i) {
+      if (!mAvailable[i]) continue;
+      out << getName(EEvent_t(i));
+      if (mBytes) out << " " << mValues[i] / mBytes << "/B";
+      if (mHits) out << " " << mValues[i] / mHits << "/hit";
+      out << " | ";
+    }
+    if (mAvailable[Event_Cycles] && mAvailable[Event_Instructions] && mValues[Event_Cycles] > 0.)
+      out << "IPC " << mValues[Event_Instructions] / mValues[Event_Cycles] << " | ";
+    out << mSamples << "/" << mCalls << " sampled";
+    return out.str();
+  }
+
+}}}
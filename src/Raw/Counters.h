@@ -0,0 +1,93 @@
+#ifndef _TOF_RAW_DATA_COUNTERS_H
+#define _TOF_RAW_DATA_COUNTERS_H
+
+#include <string>
+#include <cstdint>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** hardware performance counters of the calling thread around a stage,
+      read through perf_event_open every N calls, off by default. The
+      counters are opened on the first sampled call and follow the thread
+      that made it, a component must stay on one thread **/
+
+  class Counters {
+
+  public:
+
+    enum EEvent_t {
+      Event_Cycles,
+      Event_Instructions,
+      Event_BranchMisses,
+      Event_L1DMisses,
+      Event_LLCMisses,
+      Event_DTLBMisses,
+      Event_N
+    };
+
+    Counters() : mSampling(mDefaultSampling) {};
+    /** copies carry the totals, not the counters **/
+    Counters(const Counters &other) {*this = other;};
+    Counters &operator=(const Counters &other);
+    ~Counters() { close(); };
+
+    /** true if the call is sampled, counters read **/
+    bool start() {
+      if (!mSampling || ++mCalls % mSampling) return false;
+      return !read(mStart);
+    };
+    /** close a call opened by start, with what it processed **/
+    void stop(bool started, uint64_t bytes, uint64_t hits) {
+      if (started) accumulate(bytes, hits);
+    };
+
+    /** 0 disables the counters **/
+    void setSampling(uint32_t val) {mSampling = val;};
+    static void setDefaultSampling(uint32_t val) {mDefaultSampling = val;};
+    void merge(const Counters &other);
+    void reset();
+
+    uint64_t getSamples() const {return mSamples;};
+    uint64_t getBytes() const {return mBytes;};
+    uint64_t getHits() const {return mHits;};
+    /** -1 if the event is not available **/
+    double getValue(EEvent_t event) const {return mAvailable[event] ? mValues[event] : -1.;};
+    static const char *getName(EEvent_t event);
+    /** per-byte and per-hit ratios line **/
+    std::string summary() const;
+
+  protected:
+
+    struct Reading_t {
+      uint64_t Values[Event_N];
+      uint64_t Enabled;
+      uint64_t Running;
+    };
+
+    bool open();
+    void close();
+    bool read(Reading_t &reading);
+    void accumulate(uint64_t bytes, uint64_t hits);
+
+    static uint32_t mDefaultSampling;
+    uint32_t mSampling;
+    uint64_t mCalls = 0;
+
+    int mFd[Event_N] = {-1, -1, -1, -1, -1, -1};
+    bool mOpen = false;
+    bool mAvailable[Event_N] = {false};
+    int mNOpen = 0;
+    Reading_t mStart;
+
+    uint64_t mSamples = 0;
+    uint64_t mBytes = 0;
+    uint64_t mHits = 0;
+    double mValues[Event_N] = {0.};
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_COUNTERS_H **/
@@ -1,6 +1,10 @@
 #include "Decoder.h"
+#include "Indexer.h"
 #include <iostream>
-#include <chrono>
+#include <cstring>
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 namespace tof {
 namespace data {
@@ -11,601 +15,392 @@ namespace raw {
   {
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      std::cout << "-------- INITIALISE DECODER BUFFER ---------------------------------"
+      std::cout << "-------- INITIALISE DECODER SOURCE ---------------------------------"
 		<< " | " << mSize << " bytes"
 		<< std::endl;
     }
 #endif
-    if (mBuffer) {
-      std::cout << "Warning: a buffer was already allocated, cleaning" << std::endl;
-      delete [] mBuffer;
+    if (mSource) {
+      std::cout << "Warning: a source was already allocated, cleaning" << std::endl;
+      if (mOwnSource) delete mSource;
     }
-    mBuffer = new char[mSize];
+    mOwnSource = true;
+    mSource = Source::create(mSourceType, mSize, mDepth);
+    mBuffer = nullptr;
+    mPageSize = 0;
     return false;
   }
   
   bool
   Decoder::open(std::string name)
   {
-    if (mFile.is_open()) {
-      std::cout << "Warning: a file was already open, closing" << std::endl;
-      mFile.close();
+    /** streaming inputs cannot be mapped nor seeked **/
+    if (Source::isStream(name) && (mSourceType == Source_File || mSourceType == Source_Mapped)) {
+#ifdef DECODE_VERBOSE
+      if (mVerbose) {
+	std::cout << "Streaming input " << name << ", switching to stream source" << std::endl;
+      }
+#endif
+      mSourceType = Source_Stream;
+      if (mOwnSource) delete mSource;
+      mSource = nullptr;
     }
-    mFile.open(name.c_str(), std::fstream::in | std::fstream::binary);
-    if (!mFile.is_open()) {
-      std::cerr << "Cannot open " << name << std::endl;
-      return true;
+    if (!mSource) init();
+    if (mSource->isOpen()) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      mSource->close();
     }
-    return false;
+    mBuffer = nullptr;
+    mPageSize = 0;
+    mCarry = mCarryBegin = 0;
+    return mSource->open(name);
   }
 
   bool
   Decoder::close()
   {
-    if (mFile.is_open()) {
-      mFile.close();
-      return false;
-    }
+    mBuffer = nullptr;
+    mPageSize = 0;
+    mCarry = mCarryBegin = 0;
+    if (mSource && mSource->isOpen())
+      return mSource->close();
     return true;
   }
   
   bool
-  Decoder::load(std::string name)
+  Decoder::loadIndex(std::string name)
   {
-    if (open(name)) return true;
-    mFile.seekg(0, mFile.end);
-    mSize = mFile.tellg();
-    mFile.seekg(0);
-    mBuffer = new char[mSize];
-    mFile.read(mBuffer, mSize);
-    close();
+    Indexer indexer;
+    if (indexer.read(name)) return true;
+    mIndex = indexer.getIndex();
     return false;
   }
 
   bool
-  Decoder::read()
+  Decoder::seek(long ievent)
   {
-    if (!mFile.is_open()) {
+    if (ievent < 0 || ievent >= (long)mIndex.size()) {
+      std::cout << "Warning: event " << ievent << " not in index" << std::endl;
+      return true;
+    }
+    if (!mSource || !mSource->isOpen()) {
       std::cout << "Warning: no file is open" << std::endl;      
       return true;
     }
-    mFile.read(mBuffer, mSize);
-    mPointer = (uint32_t *)mBuffer;
-    if (!mFile) {
-      std::cout << "Nothing else to read" << std::endl;
-      return true; 
+    auto &entry = mIndex[ievent];
+    if (mSource->seek(entry.PageOffset)) {
+      std::cout << "Warning: source cannot seek" << std::endl;
+      return true;
     }
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      std::cout << "-------- READ CRU PAGE ---------------------------------------------"
-		<< " | " << mSize << " bytes"
-		<< std::endl;
+
+    /** read and depad the page, then point at the event **/
+    mPageSize = 0;
+    mCarry = mCarryBegin = 0;
+    /** read() counts the page in again **/
+    mPageCounter = entry.Page - 1;
+    mSeekWord = entry.Word;
+    if (read() || decodeRDH()) return true;
+
+    /** event continued in the next pages, it is at the front of the next view **/
+    while (mCarry && mWords + mCarryBegin == mWordsBegin)
+      if (read() || decodeRDH()) return true;
+    if (mPointer >= mWordsEnd || !IS_DRM_COMMON_HEADER(*mPointer)) {
+      std::cout << "Warning: event " << ievent << " not found in page, index out of date" << std::endl;
+      return true;
     }
-#endif
-    mPageCounter++;
     return false;
   }
-  
-  void
-  Decoder::clear()
-  {
-    mSummary.DRMCommonHeader  = 0x0;
-    mSummary.DRMOrbitHeader   = 0x0;
-    mSummary.DRMGlobalHeader  = 0x0;
-    mSummary.DRMStatusHeader1 = 0x0;
-    mSummary.DRMStatusHeader2 = 0x0;
-    mSummary.DRMStatusHeader3 = 0x0;
-    mSummary.DRMStatusHeader4 = 0x0;
-    mSummary.DRMStatusHeader5 = 0x0;
-    mSummary.DRMGlobalTrailer = 0x0;
-    mSummary.faultFlags = 0x0;
-    for (int itrm = 0; itrm < 10; itrm++) {
-      mSummary.TRMGlobalHeader[itrm]  = 0x0;
-      mSummary.TRMGlobalTrailer[itrm] = 0x0;
-      mSummary.TRMempty[itrm] = true;
-      for (int ichain = 0; ichain < 2; ichain++) {
-	mSummary.TRMChainHeader[itrm][ichain]  = 0x0;
-	mSummary.TRMChainTrailer[itrm][ichain] = 0x0;
-	for (int itdc = 0; itdc < 15; itdc++) {
-	  mSummary.nTDCUnpackedHits[itrm][ichain][itdc] = 0;
-	}}}
-  }
-
-  inline void
-  Decoder::next32()
-  {
-    mPointer += mSkip;
-    mSkip = (mSkip + 2) % 4;
-    mByteCounter += 4;
-  }
 
-  inline void
-  Decoder::next128()
+  long
+  Decoder::pageSize(const RDH_t *rdh)
   {
-    mPointer += 4;
-    mRDH = reinterpret_cast<RDH_t *>(mPointer);
+    long size = rdh->Word0.OffsetNewPacket;
+    if (size == 0) size = rdh->Word0.MemorySize;
+    if (rdh->Word0.HeaderSize < 4 * sizeof(RDHWord_t) || size < rdh->Word0.HeaderSize || size < rdh->Word0.MemorySize)
+      return -1;
+    return size;
   }
   
   bool
-  Decoder::decodeRDH()
+  Decoder::read()
   {
-    mRDH = reinterpret_cast<RDH_t *>(mPointer);
-
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      std::cout << "-------- START DECODE RDH ------------------------------------------"
-		<< " | " << mPageCounter << " pages"
-		<< std::endl;    
+    if (!mSource || !mSource->isOpen()) {
+      std::cout << "Warning: no file is open" << std::endl;      
+      return true;
     }
-#endif
+    /** release previous page **/
+    release();
 
-    mSummary.RDHWord0 = mRDH->Word0;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      uint32_t BlockLength = mRDH->Word0.BlockLength;
-      uint32_t PacketCounter = mRDH->Word0.PacketCounter;
-      uint32_t HeaderSize = mRDH->Word0.HeaderSize;
-      uint32_t MemorySize = mRDH->Word0.MemorySize;
-      printf(" %08x%08x%08x%08x RDH Word0 (MemorySize=%d, PacketCounter=%d) \n", mRDH->Data[3], mRDH->Data[2], mRDH->Data[1], mRDH->Data[0],
-	     MemorySize, PacketCounter);
+    /** peek RDH and get packet size **/
+    auto rdh = reinterpret_cast<RDH_t *>(mSource->peek(sizeof(RDHWord_t)));
+    if (!rdh) {
+      if (!mSource->isBad()) std::cout << "Nothing else to read" << std::endl;
+      return true; 
     }
-#endif
-    next128();
-
-    mSummary.RDHWord1 = mRDH->Word1;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      uint32_t TrgOrbit = mRDH->Word1.TrgOrbit;
-      uint32_t HbOrbit = mRDH->Word1.HbOrbit;
-      printf(" %08x%08x%08x%08x RDH Word1 (TrgOrbit=%d, HbOrbit=%d) \n", mRDH->Data[3], mRDH->Data[2], mRDH->Data[1], mRDH->Data[0],
-	     TrgOrbit, HbOrbit);
+    long size = pageSize(rdh);
+    if (size < 0) {
+      std::cout << "Warning: bad RDH packet size"
+		<< " (OffsetNewPacket=" << rdh->Word0.OffsetNewPacket
+		<< ", MemorySize=" << rdh->Word0.MemorySize
+		<< ", HeaderSize=" << rdh->Word0.HeaderSize << ")"
+		<< std::endl;
+      return true;
     }
-#endif
-    next128();
 
-    mSummary.RDHWord2 = mRDH->Word2;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      uint32_t TrgBC = mRDH->Word2.TrgBC;
-      uint32_t HbBC = mRDH->Word2.HbBC;
-      uint32_t TrgType = mRDH->Word2.TrgType;
-      printf(" %08x%08x%08x%08x RDH Word2 (TrgBC=%d, HbBC=%d, TrgType=%d) \n", mRDH->Data[3], mRDH->Data[2], mRDH->Data[1], mRDH->Data[0],
-	     TrgBC, HbBC, TrgType);
+    /** get a window on the whole packet **/
+    mBuffer = mSource->peek(size);
+    if (!mBuffer) {
+      if (!mSource->isBad()) std::cout << "Nothing else to read" << std::endl;
+      return true; 
     }
-#endif
-    next128();
-
-    mSummary.RDHWord3 = mRDH->Word3;
+    mPageSize = size;
+    mPointer = (uint32_t *)mBuffer;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      printf(" %08x%08x%08x%08x RDH Word3 \n", mRDH->Data[3], mRDH->Data[2], mRDH->Data[1], mRDH->Data[0]);
+      std::cout << "-------- READ CRU PAGE ---------------------------------------------"
+		<< " | " << mPageSize << " bytes"
+		<< std::endl;
     }
 #endif
-    next128();
-
+    mPageCounter++;
     return false;
   }
   
   bool
-  Decoder::decode()
+  Decoder::release()
   {
+    bool status = mPageSize && mSource->consume(mPageSize);
+    mPageSize = 0;
+    mBuffer = nullptr;
+    return status;
+  }
 
-    /** check if we have memory to decode **/
-    if ((char *)mPointer - mBuffer >= mSummary.RDHWord0.MemorySize) {
-#ifdef DECODE_VERBOSE
-      if (mVerbose) {
-	std::cout << "Warning: decode request exceeds memory size" << std::endl;
-      }
-#endif
-      return true;
-    }
-
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      std::cout << "-------- START DECODE EVENT ----------------------------------------" << std::endl;    
+  uint32_t *
+  Decoder::scan(uint32_t *from, uint32_t *end, uint32_t lo, uint32_t hi)
+  {
+    auto p = from;
+#ifdef __AVX2__
+    const __m256i vlo = _mm256_set1_epi32(lo - 1), vhi = _mm256_set1_epi32(hi + 1);
+    for (; p + 8 <= end; p += 8) {
+      __m256i type = _mm256_srli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), 28);
+      __m256i hit = _mm256_and_si256(_mm256_cmpgt_epi32(type, vlo), _mm256_cmpgt_epi32(vhi, type));
+      int mask = _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+      if (mask) return p + __builtin_ctz(mask);
     }
 #endif
-
-    /** init decoder **/
-    auto start = std::chrono::high_resolution_clock::now();
-    mByteCounter = 0;
-    mSkip = 1;
-    clear();
-    
-    /** check DRM Common Header **/
-    if (!IS_DRM_COMMON_HEADER(*mPointer)) {
-#ifdef DECODE_VERBOSE
-      printf(" %08x [ERROR] fatal error \n", *mPointer);
-#endif
-      return true;
-    }
-    mSummary.DRMCommonHeader = *mPointer;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      auto DRMCommonHeader = reinterpret_cast<DRMCommonHeader_t *>(mPointer);
-      auto Payload = DRMCommonHeader->Payload;
-      printf(" %08x DRM Common Header     (Payload=%d) \n", *mPointer, Payload);
+#ifdef __SSE2__
+    const __m128i wlo = _mm_set1_epi32(lo - 1), whi = _mm_set1_epi32(hi + 1);
+    for (; p + 4 <= end; p += 4) {
+      __m128i type = _mm_srli_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), 28);
+      __m128i hit = _mm_and_si128(_mm_cmpgt_epi32(type, wlo), _mm_cmpgt_epi32(whi, type));
+      int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+      if (mask) return p + __builtin_ctz(mask);
     }
 #endif
-    next32();
+    for (; p < end; ++p)
+      if ((*p >> 28) >= lo && (*p >> 28) <= hi) return p;
+    return end;
+  }
 
-    /** DRM Orbit Header **/
-    mSummary.DRMOrbitHeader = *mPointer;
+  bool
+  Decoder::resync()
+  {
+    /** the sentinel words past the end make the look-ahead safe **/
+    auto p = mPointer;
+    while ((p = scan(p, mWordsEnd, 4, 4)) < mWordsEnd && !IS_DRM_GLOBAL_HEADER(p[2]))
+      p++;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      auto DRMOrbitHeader = reinterpret_cast<DRMOrbitHeader_t *>(mPointer);
-      auto Orbit = DRMOrbitHeader->Orbit;
-      printf(" %08x DRM Orbit Header      (Orbit=%d) \n", *mPointer, Orbit);
+      printf(" [ERROR] skipped %ld bytes to resync DRM decode stream \n", 4 * (p - mPointer));
     }
 #endif
-    next32();    
+    skip(p);
+    mPointer = p;
+    return mPointer >= mWordsEnd;
+  }
 
-    /** check DRM Global Header **/
-    if (!IS_DRM_GLOBAL_HEADER(*mPointer)) {
-#ifdef DECODE_VERBOSE
-      printf(" %08x [ERROR] fatal error \n", *mPointer);
-#endif
-      return true;
-    }
-    mSummary.DRMGlobalHeader = *mPointer;
+  bool
+  Decoder::selectRDH()
+  {
+    uint32_t version = reinterpret_cast<RDH_t *>(mPointer)->Word0.HeaderVersion;
+    if (version > RDHLatestVersion)
+      std::cout << "Warning: unknown RDH version " << version << ", read as version " << RDHLatestVersion << std::endl;
+    if (RDHLayout<4>::accepts(version))
+      mDecodeRDH = &Decoder::parseRDH<4>;
+    else
+      mDecodeRDH = &Decoder::parseRDH<6>;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      auto DRMGlobalHeader = reinterpret_cast<DRMGlobalHeader_t *>(mPointer);
-      auto DRMID = DRMGlobalHeader->DRMID;
-      printf(" %08x DRM Global Header     (DRMID=%d) \n", *mPointer, DRMID);
+      std::cout << "-------- RDH VERSION " << version << " ----------------------------------------------" << std::endl;
     }
 #endif
-    next32();
+    return (this->*mDecodeRDH)();
+  }
 
-    /** DRM Status Header 1 **/
-    mSummary.DRMStatusHeader1 = *mPointer;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      auto DRMStatusHeader1 = reinterpret_cast<DRMStatusHeader1_t *>(mPointer);
-      auto ParticipatingSlotID = DRMStatusHeader1->ParticipatingSlotID;
-      auto CBit = DRMStatusHeader1->CBit;
-      auto DRMhSize = DRMStatusHeader1->DRMhSize;
-      printf(" %08x DRM Status Header 1   (ParticipatingSlotID=0x%03x, CBit=%d, DRMhSize=%d) \n", *mPointer, ParticipatingSlotID, CBit, DRMhSize);
-    }
-#endif
-    next32();
+  template <int V>
+  bool
+  Decoder::parseRDH()
+  {
+    mRDH = reinterpret_cast<RDH_t *>(mPointer);
+    if (!RDHLayout<V>::accepts(mRDH->Word0.HeaderVersion)) return selectRDH();
 
-    /** DRM Status Header 2 **/
-    mSummary.DRMStatusHeader2 = *mPointer;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      auto DRMStatusHeader2 = reinterpret_cast<DRMStatusHeader2_t *>(mPointer);
-      auto SlotEnableMask = DRMStatusHeader2->SlotEnableMask;
-      auto FaultID = DRMStatusHeader2->FaultID;
-      auto RTOBit = DRMStatusHeader2->RTOBit;
-      printf(" %08x DRM Status Header 2   (SlotEnableMask=0x%03x, FaultID=%d, RTOBit=%d) \n", *mPointer, SlotEnableMask, FaultID, RTOBit);
+      std::cout << "-------- START DECODE RDH ------------------------------------------"
+		<< " | " << mPageCounter << " pages"
+		<< std::endl;    
     }
 #endif
-    next32();
 
-    /** DRM Status Header 3 **/
-    mSummary.DRMStatusHeader3 = *mPointer;
+    /** the fixed four words are kept as read, the payload starts after HeaderSize bytes **/
+    auto &summary = mSummary.getSummary();
+    summary.RDHWord0 = getRDHWord(mRDH, 0)->Word0;
+    summary.RDHWord1 = getRDHWord(mRDH, 1)->Word1;
+    summary.RDHWord2 = getRDHWord(mRDH, 2)->Word2;
+    summary.RDHWord3 = getRDHWord(mRDH, 3)->Word3;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      auto DRMStatusHeader3 = reinterpret_cast<DRMStatusHeader3_t *>(mPointer);
-      auto L0BCID = DRMStatusHeader3->L0BCID;
-      auto RunTimeInfo = DRMStatusHeader3->RunTimeInfo;
-      printf(" %08x DRM Status Header 3   (L0BCID=%d, RunTimeInfo=0x%03x) \n", *mPointer, L0BCID, RunTimeInfo);
+      uint32_t PacketCounter = mRDH->Word0.PacketCounter;
+      uint32_t MemorySize = mRDH->Word0.MemorySize;
+      uint32_t FeeID = RDHLayout<V>::FeeID(mRDH);
+      uint32_t Orbit = RDHLayout<V>::Orbit(mRDH);
+      uint32_t BC = RDHLayout<V>::BC(mRDH);
+      uint32_t TrgType = RDHLayout<V>::TrgType(mRDH);
+      uint32_t StopBit = RDHLayout<V>::StopBit(mRDH);
+      for (int i = 0; i < 4; ++i) {
+	auto word = getRDHWord(mRDH, i);
+	printf(" %08x%08x%08x%08x RDH Word%d \n", word->Data[3], word->Data[2], word->Data[1], word->Data[0], i);
+      }
+      printf(" (FeeID=%d, MemorySize=%d, PacketCounter=%d, Orbit=%d, BC=%d, TrgType=%d, StopBit=%d) \n",
+	     FeeID, MemorySize, PacketCounter, Orbit, BC, TrgType, StopBit);
     }
 #endif
-    next32();
+    mPointer = reinterpret_cast<uint32_t *>(mBuffer + mRDH->Word0.HeaderSize);
 
-    /** DRM Status Header 4 **/
-    mSummary.DRMStatusHeader4 = *mPointer;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      printf(" %08x DRM Status Header 4 \n", *mPointer);
-    }
-#endif
-    next32();
+    depad();
+    stitch<V>();
+    return false;
+  }
 
-    /** DRM Status Header 5 **/
-    mSummary.DRMStatusHeader5 = *mPointer;
-#ifdef DECODE_VERBOSE
-    if (mVerbose) {
-      printf(" %08x DRM Status Header 5 \n", *mPointer);
+  template <int V>
+  bool
+  Decoder::stitch()
+  {
+    /** walk the events to the last one, a page may well end on an orbit
+        word that looks like a DRM global trailer **/
+    long nwords = mWordsEnd - mWords;
+    if (mWordsEnd == mPointer) return false;
+    bool closed = true;
+    long j = mPointer - mWords;
+    while (j < nwords && IS_DRM_COMMON_HEADER(mWords[j])) {
+      long k = Indexer::eventEnd(mWords, j, nwords, closed);
+      if (!closed) break;
+      j = k;
     }
-#endif
-    next32();
+    if (closed) return false;
 
-    /** loop over DRM payload **/
+    /** the page is already depadded, release it and look at the next one **/
+    auto rdh = reinterpret_cast<RDH_t *>(mBuffer);
+    uint32_t FeeID = RDHLayout<V>::FeeID(rdh), CruID = rdh->Word0.CruID;
+    release();
     while (true) {
-
-      /** LTM global header detected **/
-      if (IS_LTM_GLOBAL_HEADER(*mPointer)) {
-	
-#ifdef DECODE_VERBOSE
-	if (mVerbose) {
-	  printf(" %08x LTM Global Header \n", *mPointer);
-	}
-#endif
-	next32();
-
-	/** loop over LTM payload **/
-	while (true) {
-
-	  /** LTM global trailer detected **/
-	  if (IS_LTM_GLOBAL_TRAILER(*mPointer)) {
-#ifdef DECODE_VERBOSE
-	    if (mVerbose) {
-	      printf(" %08x LTM Global Trailer \n", *mPointer);
-	    }
-#endif
-	    next32();
-	    break;
-	  }
-
-#ifdef DECODE_VERBOSE
-	  if (mVerbose) {
-	    printf(" %08x LTM data \n", *mPointer);
-	  }
-#endif
-	  next32();
-	}
-	
-      }
-      
-      /** TRM global header detected **/
-      if (IS_TRM_GLOBAL_HEADER(*mPointer) && GET_TRM_SLOTID(*mPointer) > 2) {
-	uint32_t SlotID = GET_TRM_SLOTID(*mPointer);
-	int itrm = SlotID - 3;
-	mSummary.TRMGlobalHeader[itrm] = *mPointer;
-#ifdef DECODE_VERBOSE
-	if (mVerbose) {
-	  auto TRMGlobalHeader = reinterpret_cast<TRMGlobalHeader_t *>(mPointer);
-	  auto EventWords = TRMGlobalHeader->EventWords;
-	  auto EventNumber = TRMGlobalHeader->EventNumber;
-	  auto EBit = TRMGlobalHeader->EBit;
-	  printf(" %08x TRM Global Header     (SlotID=%d, EventWords=%d, EventNumber=%d, EBit=%01x) \n", *mPointer, SlotID, EventWords, EventNumber, EBit);
-	}
-#endif
-	next32();
-	
-	/** loop over TRM payload **/
-	while (true) {
-
-	  /** TRM chain-A header detected **/
-	  if (IS_TRM_CHAINA_HEADER(*mPointer) && GET_TRM_SLOTID(*mPointer) == SlotID) {
-	    int ichain = 0;
-	    mSummary.TRMChainHeader[itrm][ichain] = *mPointer;
-#ifdef DECODE_VERBOSE
-	    if (mVerbose) {
-	      auto TRMChainHeader = reinterpret_cast<TRMChainHeader_t *>(mPointer);
-	      auto BunchID = TRMChainHeader->BunchID;
-	      printf(" %08x TRM Chain-A Header    (SlotID=%d, BunchID=%d) \n", *mPointer, SlotID, BunchID);
-	    }
-#endif
-	    next32();
-
-	    /** loop over TRM chain-A payload **/
-	    while (true) {
-	      
-	      /** TDC hit detected **/
-	      if (IS_TDC_HIT(*mPointer)) {
-                mSummary.TRMempty[itrm] = false;
-                auto itdc = GET_TDCHIT_TDCID(*mPointer);
-		auto ihit = mSummary.nTDCUnpackedHits[itrm][ichain][itdc];
-		mSummary.TDCUnpackedHit[itrm][ichain][itdc][ihit] = *mPointer;
-		mSummary.nTDCUnpackedHits[itrm][ichain][itdc]++;
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  auto TDCUnpackedHit = reinterpret_cast<TDCUnpackedHit_t *>(mPointer);
-		  auto HitTime = TDCUnpackedHit->HitTime;
-		  auto Chan = TDCUnpackedHit->Chan;
-		  auto TDCID = TDCUnpackedHit->TDCID;
-		  auto EBit = TDCUnpackedHit->EBit;
-		  auto PSBits = TDCUnpackedHit->PSBits;
-		  printf(" %08x TDC Hit               (HitTime=%d, Chan=%d, TDCID=%d, EBit=%d, PSBits=%d \n", *mPointer, HitTime, Chan, TDCID, EBit, PSBits);
-		}
-#endif
-		next32();
-		continue;
-	      }
-	      
-	      /** TDC error detected **/
-	      if (IS_TDC_ERROR(*mPointer)) {
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  printf(" %08x TDC error \n", *mPointer);
-		}
-#endif
-		next32();
-		continue;
-	      }
-	      
-	      /** TRM chain-A trailer detected **/
-	      if (IS_TRM_CHAINA_TRAILER(*mPointer)) {
-		mSummary.TRMChainTrailer[itrm][ichain] = *mPointer;
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  auto TRMChainTrailer = reinterpret_cast<TRMChainTrailer_t *>(mPointer);
-		  auto EventCounter = TRMChainTrailer->EventCounter;
-		  printf(" %08x TRM Chain-A Trailer   (SlotID=%d, EventCounter=%d) \n", *mPointer, SlotID, EventCounter);
-		}
-#endif
-		next32();
-		break;
-	      }
-	      
-#ifdef DECODE_VERBOSE
-	      if (mVerbose) {
-		printf(" %08x [ERROR] breaking TRM Chain-A decode stream \n", *mPointer);
-	      }
-#endif
-	      next32();
-	      break;
-	      
-	    }} /** end of loop over TRM chain-A payload **/	    
-	  
-	  /** TRM chain-B header detected **/
-	  if (IS_TRM_CHAINB_HEADER(*mPointer) && GET_TRM_SLOTID(*mPointer) == SlotID) {
-	    int ichain = 1;
-	    mSummary.TRMChainHeader[itrm][ichain] = *mPointer;
-#ifdef DECODE_VERBOSE
-	    if (mVerbose) {
-	      auto TRMChainHeader = reinterpret_cast<TRMChainHeader_t *>(mPointer);
-	      auto BunchID = TRMChainHeader->BunchID;
-	      printf(" %08x TRM Chain-B Header    (SlotID=%d, BunchID=%d) \n", *mPointer, SlotID, BunchID);
-	    }
-#endif
-	    next32();
-	    
-	    /** loop over TRM chain-B payload **/
-	    while (true) {
-	      
-	      /** TDC hit detected **/
-	      if (IS_TDC_HIT(*mPointer)) {
-                mSummary.TRMempty[itrm] = false;
-                auto itdc = GET_TDCHIT_TDCID(*mPointer);
-		auto ihit = mSummary.nTDCUnpackedHits[itrm][ichain][itdc];
-		mSummary.TDCUnpackedHit[itrm][ichain][itdc][ihit] = *mPointer;
-		mSummary.nTDCUnpackedHits[itrm][ichain][itdc]++;
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  auto TDCUnpackedHit = reinterpret_cast<TDCUnpackedHit_t *>(mPointer);
-		  auto HitTime = TDCUnpackedHit->HitTime;
-		  auto Chan = TDCUnpackedHit->Chan;
-		  auto TDCID = TDCUnpackedHit->TDCID;
-		  auto EBit = TDCUnpackedHit->EBit;
-		  auto PSBits = TDCUnpackedHit->PSBits;
-		  printf(" %08x TDC Hit               (HitTime=%d, Chan=%d, TDCID=%d, EBit=%d, PSBits=%d \n", *mPointer, HitTime, Chan, TDCID, EBit, PSBits);
-		}
-#endif
-		next32();
-		continue;
-	      }
-	      
-	      /** TDC error detected **/
-	      if (IS_TDC_ERROR(*mPointer)) {
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  printf(" %08x TDC error \n", *mPointer);
-		}
-#endif
-		next32();
-		continue;
-	      }
-	      
-	      /** TRM chain-B trailer detected **/
-	      if (IS_TRM_CHAINB_TRAILER(*mPointer)) {
-		mSummary.TRMChainTrailer[itrm][ichain] = *mPointer;
-#ifdef DECODE_VERBOSE
-		if (mVerbose) {
-		  auto TRMChainTrailer = reinterpret_cast<TRMChainTrailer_t *>(mPointer);
-		  auto EventCounter = TRMChainTrailer->EventCounter;
-		  printf(" %08x TRM Chain-B Trailer   (SlotID=%d, EventCounter=%d) \n", *mPointer, SlotID, EventCounter);
-		}
-#endif
-		next32();
-		break;
-	      }
-	      
-#ifdef DECODE_VERBOSE
-	      if (mVerbose) {
-		printf(" %08x [ERROR] breaking TRM Chain-B decode stream \n", *mPointer);
-	      }
-#endif
-	      next32();
-	      break;
-	      
-	    }} /** end of loop over TRM chain-A payload **/	    
-	  
-	  /** TRM global trailer detected **/
-	  if (IS_TRM_GLOBAL_TRAILER(*mPointer)) {
-	    mSummary.TRMGlobalTrailer[itrm] = *mPointer;
-#ifdef DECODE_VERBOSE
-	    if (mVerbose) {
-	      auto TRMGlobalTrailer = reinterpret_cast<TRMGlobalTrailer_t *>(mPointer);
-	      auto EventCRC = TRMGlobalTrailer->EventCRC;
-	      auto LBit = TRMGlobalTrailer->LBit;
-	      printf(" %08x TRM Global Trailer    (SlotID=%d, EventCRC=%d, LBit=%d) \n", *mPointer, SlotID, EventCRC, LBit);
-	    }
-#endif
-	    next32();
-	    
- 	    /** filler detected **/
-	    if (IS_FILLER(*mPointer)) {
-#ifdef DECODE_VERBOSE
-	      if (mVerbose) {
-		printf(" %08x Filler \n", *mPointer);
-	      }
-#endif
-	      next32();
-	    }
-	    
-	    break;
-	  }
-	  
-#ifdef DECODE_VERBOSE
-	  if (mVerbose) {
-	    printf(" %08x [ERROR] breaking TRM decode stream \n", *mPointer);
-	  }
-#endif
-	  next32();
-	  break;
-	  
-	} /** end of loop over TRM payload **/
-	
+      rdh = reinterpret_cast<RDH_t *>(mSource->peek(sizeof(RDHWord_t)));
+      if (!rdh) return false;
+      long size = pageSize(rdh);
+      if (size < 0 || RDHLayout<V>::FeeID(rdh) != FeeID || rdh->Word0.CruID != CruID) return false;
+      /** empty pages (e.g. HBF stop pages) carry nothing, skip them **/
+      if (rdh->Word0.MemorySize <= rdh->Word0.HeaderSize) {
+	if (!mSource->peek(size) || mSource->consume(size)) return false;
+	mPageCounter++;
 	continue;
       }
-      
-      /** DRM global trailer detected **/
-      if (IS_DRM_GLOBAL_TRAILER(*mPointer)) {
-	mSummary.DRMGlobalTrailer = *mPointer;
-#ifdef DECODE_VERBOSE
-	if (mVerbose) {
-	  auto DRMGlobalTrailer = reinterpret_cast<DRMGlobalTrailer_t *>(mPointer);
-	  auto LocalEventCounter = DRMGlobalTrailer->LocalEventCounter;
-	  printf(" %08x DRM Global Trailer    (LocalEventCounter=%d) \n", *mPointer, LocalEventCounter);
-	}
-#endif
-	next32();
-	
-	/** filler detected **/
-	if (IS_FILLER(*mPointer)) {
-#ifdef DECODE_VERBOSE
-	  if (mVerbose) {
-	    printf(" %08x Filler \n", *mPointer);
-	  }
-#endif
-	  next32();
-	}
-	
-	break;
-      }
-      
-#ifdef DECODE_VERBOSE
-      if (mVerbose) {
-	printf(" %08x [ERROR] trying to recover DRM decode stream \n", *mPointer);
-      }
-#endif
-      next32();
-      
-    } /** end of loop over DRM payload **/
-    
-    auto finish = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = finish - start;
-    
-    mIntegratedBytes += mByteCounter;
-    mIntegratedTime += elapsed.count();
-    
+      auto page = mSource->peek(size);
+      if (!page || !Indexer::continues(nwords - j, page)) return false;
+      break;
+    }
+
+    /** the next page continues the open event, carry it over **/
+    mCarryBegin = j;
+    mCarry = nwords - j;
+    mWordsEnd = mWords + j;
 #ifdef DECODE_VERBOSE
     if (mVerbose) {
-      std::cout << "-------- END DECODE EVENT ------------------------------------------"
-		<< " | " << mByteCounter << " bytes"
-		<< " | " << 1.e3  * elapsed.count() << " ms"
-		<< " | " << 1.e-6 * mIntegratedBytes / mIntegratedTime << " MB/s (average)"
+      std::cout << "-------- EVENT CONTINUES IN NEXT PAGE ------------------------------"
+		<< " | " << 4 * mCarry << " bytes"
 		<< std::endl;
     }
 #endif
-
     return false;
   }
-
+  
+  void
+  Decoder::depad()
+  {
+    /** GBT words carry two valid 32-bit words in the low half of 128 bits **/
+    auto gbt = mPointer;
+    long bytes = mBuffer + mSummary.getSummary().RDHWord0.MemorySize - (char *)gbt;
+    if (bytes < 0) bytes = 0;
+    long ngbt = bytes / 16;
+    long nwords = 2 * ngbt + (bytes % 16) / 4;
+    if (nwords > 2 * ngbt + 2) nwords = 2 * ngbt + 2;
+
+    /** an event left open by the previous page stays where it is and the
+        payload goes right after it, the open words are moved to the front
+        only when the buffer runs out of room, as a ring wraps around **/
+    long carry = mCarry;
+    long begin = carry ? mCarryBegin : 0;
+    mCarry = mCarryBegin = 0;
+
+    /** dense buffer with zero sentinel words past the end, room for a few
+        pages so that the wrap is rare when events keep spanning pages **/
+    if (begin + carry + nwords + DEPAD_SENTINEL > mWordsSize) {
+      if (carry + nwords + DEPAD_SENTINEL > mWordsSize) {
+	auto words = mWords;
+	mWordsSize = 4 * (carry + nwords + DEPAD_SENTINEL);
+	mWords = new uint32_t[mWordsSize];
+	if (carry) std::memcpy(mWords, words + begin, carry * sizeof(uint32_t));
+	delete [] words;
+      }
+      else if (carry)
+	std::memmove(mWords, mWords + begin, carry * sizeof(uint32_t));
+      begin = 0;
+    }
+    uint32_t *out = mWords + begin + carry;
+    long i = 0;
+#ifdef __AVX2__
+    for (; i + 4 <= ngbt; i += 4) {
+      __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(gbt + 4 * i));
+      __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(gbt + 4 * i + 8));
+      __m256i c = _mm256_permute4x64_epi64(_mm256_unpacklo_epi64(a, b), 0xD8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 2 * i), c);
+    }
+#endif
+#ifdef __SSE2__
+    for (; i + 2 <= ngbt; i += 2) {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gbt + 4 * i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(gbt + 4 * i + 4));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_unpacklo_epi64(a, b));
+    }
+#endif
+    for (; i < ngbt; ++i) {
+      out[2 * i] = gbt[4 * i];
+      out[2 * i + 1] = gbt[4 * i + 1];
+    }
+    for (long j = 2 * ngbt; j < nwords; ++j)
+      out[j] = gbt[4 * ngbt + j - 2 * ngbt];
+    for (long j = nwords; j < nwords + DEPAD_SENTINEL; ++j)
+      out[j] = 0x0;
+    
+    mPointer = mWords + begin;
+    mWordsEnd = out + nwords;
+
+    /** a filler left over from an event closed in the previous page **/
+    if (!carry && nwords && IS_FILLER(*mPointer)) mPointer++;
+    /** start from the event requested by seek **/
+    if (mSeekWord > 0 && mSeekWord <= nwords) mPointer = mWords + mSeekWord;
+    mSeekWord = 0;
+    mWordsBegin = mCounted = mPointer;
+  }
+  
 }}}
 
@@ -1,10 +1,18 @@
 #ifndef _TOF_RAW_DATA_DECODER_H
 #define _TOF_RAW_DATA_DECODER_H
 
-#include <fstream>
 #include <string>
 #include <cstdint>
+#include <vector>
 #include "Raw/dataFormat.h"
+#include "Raw/RDH.h"
+#include "Raw/Source.h"
+#include "Raw/SummaryVisitor.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
+#include "Raw/Statistics.h"
+
+#define DEPAD_SENTINEL 8
 
 namespace tof {
 namespace data {
@@ -15,51 +23,111 @@ namespace raw {
   public:
     
     Decoder() {};
-    ~Decoder() {};
+    ~Decoder() { if (mOwnSource) delete mSource; delete [] mWords; };
 
     bool init();
     bool open(std::string name);
-    bool load(std::string name);
     bool read();
-    bool decodeRDH();
-    bool decode();
-    void rewind() {mPointer = (uint32_t *)mBuffer;};
+    /** give the page back to the source, its words stay decoded until the next read **/
+    bool release();
+    /** RDH with the layout of its version, picked on the first page and again only if the version changes **/
+    bool decodeRDH() {return (this->*mDecodeRDH)();};
+    /** decode one event, the summary path is the SummaryVisitor **/
+    bool decode() {return decode(mSummary);};
+    template <typename V> bool decode(V &visitor);
+    /** back to the first event of the current page, the bytes skipped before this point are not counted again **/
+    void rewind() {if (mPointer > mCounted) mCounted = mPointer; mPointer = mWordsBegin;};
+    /** skip to the next DRM common header + global header pair, true if none in the page **/
+    bool resync();
     bool close();
+    /** random access through an event index **/
+    bool loadIndex(std::string name);
+    bool seek(long ievent);
+    long getNEvents() const {return mIndex.size();};
 
     void setVerbose(bool val) {mVerbose = val;};
-    void setSkip(int val) {mSkip = val;};
     void setSize(long val) {mSize = val;};
-    Summary_t &getSummary() {return mSummary;};
+    void setSource(ESource_t val) {mSourceType = val;};
+    /** read pages from an external source, not owned (e.g. one link of a Demux) **/
+    void attach(Source *val) {if (mOwnSource) delete mSource; mSource = val; mOwnSource = false;};
+    void setDepth(int val) {mDepth = val;};
+    /** decode only the selected slots (bit SlotID - 2, as ParticipatingSlotID, bit 0 is the LTM),
+        the others are jumped over with their EventWords **/
+    void setSlotMask(uint32_t val) {mSlotMask = val; mSummary.setSlotMask(val);};
+    /** decode the hits of the selected TRM chains only (bit 2 * (SlotID - 3) + chain) **/
+    void setChainMask(uint32_t val) {mChainMask = val;};
+    /** run the Checker consistency checks while decoding, result in the summary checkError **/
+    void setCheck(bool val) {mSummary.setCheck(val);};
+    /** count the DRM and TRM words, for the checks on EventWords **/
+    void setIntegrity(bool val) {mIntegrity = val; mSummary.setIntegrity(val);};
+    /** count the faults found by the inline checks over the run, by crate, TRM and chain **/
+    void setStatistics(bool val) {mSummary.setStatistics(val);};
+    Statistics &getStatistics() {return mSummary.getStatistics();};
+    Summary_t &getSummary() {return mSummary.getSummary();};
+    uint32_t getPageCounter() const {return mPageCounter;};
+    /** the input failed rather than ended **/
+    bool isBad() const {return mSource && mSource->isBad();};
+
+    /** CRU page size from the RDH, -1 if not sane **/
+    static long pageSize(const RDH_t *rdh);
+    /** first word in [from, end) with the top nibble in [lo, hi], end if none **/
+    static uint32_t *scan(uint32_t *from, uint32_t *end, uint32_t lo, uint32_t hi);
+    /** bytes skipped to recover from corrupted data **/
+    uint64_t getSkippedBytes() const {return mSkippedBytes;};
 
     // benchmarks
     double mIntegratedBytes = 0.;
-    double mIntegratedTime = 0.;
+    Timer mTimer;
+    Counters mCounters;
     
   protected:
 
-    void clear();
-
-    inline void next128();
-    inline void next32();
+    void next32() {mPointer++; mByteCounter += 4;};
+    /** count the bytes skipped from here to this word, once even if the page is decoded again after a rewind **/
+    void skip(uint32_t *to) {auto from = mPointer > mCounted ? mPointer : mCounted; if (to > from) mSkippedBytes += 4 * (to - from);};
+    bool selectRDH();
+    template <int V> bool parseRDH();
+    void depad();
+    template <int V> bool stitch();
     
-    std::ifstream mFile;
+    Source *mSource = nullptr;
+    bool mOwnSource = true;
+    ESource_t mSourceType = Source_File;
+    int mDepth = 4;
     char *mBuffer = nullptr;
     long mSize = 8192;
+    long mPageSize = 0;
     uint32_t *mPointer = nullptr;
+    uint32_t *mWords = nullptr;
+    uint32_t *mWordsEnd = nullptr;
+    long mWordsSize = 0;
+    uint32_t *mWordsBegin = nullptr;
+    uint32_t *mCounted = nullptr; // end of the words decoded before a rewind
+    long mCarry = 0;      // words of an event continued in the next page
+    long mCarryBegin = 0; // where they start in the word buffer
+    long mSeekWord = 0;
     char *mRewind = nullptr;
 
     bool mVerbose = false;
-    uint32_t mSkip = 1;
+    uint32_t mSlotMask = 0x7ff;
+    uint32_t mChainMask = 0xfffff;
+    bool mIntegrity = false;
     uint32_t mSlotID;
     uint32_t mWordType;
     RDH_t *mRDH;
-    Summary_t mSummary;    
+    bool (Decoder::*mDecodeRDH)() = &Decoder::selectRDH;
+    SummaryVisitor mSummary;
+    std::vector<EventIndex_t> mIndex;
 
     uint32_t mPageCounter = 0;
     uint32_t mByteCounter = 0;
+    uint32_t mHitCounter = 0;
+    uint64_t mSkippedBytes = 0;
     
   };
   
 }}}
 
+#include "Raw/Decoder.hxx"
+
 #endif /** _TOF_RAW_DATA_DECODER_H **/
@@ -0,0 +1,498 @@
+#ifndef _TOF_RAW_DATA_DECODER_HXX
+#define _TOF_RAW_DATA_DECODER_HXX
+
+/** templated decode loop, included by Decoder.h **/
+
+#include <iostream>
+#include <cstdio>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** decoder states and actions **/
+  
+  enum EDecodeState_t {
+    State_DRM,         // DRM payload
+    State_LTM,         // LTM payload
+    State_TRM,         // TRM payload, expecting chain-A, chain-B or trailer
+    State_TRMChainB,   // TRM payload after chain-A, expecting chain-B or trailer
+    State_TRMTrailer,  // TRM payload after chain-B, expecting trailer
+    State_ChainA,      // TRM chain-A payload
+    State_ChainB,      // TRM chain-B payload
+    State_End
+  };
+
+  enum EDecodeAction_t {
+    Action_Error,
+    Action_GlobalHeader,
+    Action_DRMTrailer,
+    Action_LTMData,
+    Action_LTMTrailer,
+    Action_ChainHeader,
+    Action_ChainTrailer,
+    Action_TRMTrailer,
+    Action_TDCError,
+    Action_Hit
+  };
+
+  /** action by state and word type (top nibble) **/
+  
+#define E_ Action_Error
+#define GH Action_GlobalHeader
+#define DT Action_DRMTrailer
+#define LD Action_LTMData
+#define LT Action_LTMTrailer
+#define CH Action_ChainHeader
+#define CT Action_ChainTrailer
+#define TT Action_TRMTrailer
+#define TE Action_TDCError
+#define HT Action_Hit
+  
+  static const uint8_t DecodeTable[State_End][16] = {
+    /*  0   1   2   3   4   5   6   7   8   9   a   b   c   d   e   f  */
+    { E_, E_, E_, E_, GH, DT, E_, E_, E_, E_, E_, E_, E_, E_, E_, E_ }, // State_DRM
+    { LD, LD, LD, LD, LD, LT, LD, LD, LD, LD, LD, LD, LD, LD, LD, LD }, // State_LTM
+    { CH, E_, CH, E_, E_, TT, E_, E_, E_, E_, E_, E_, E_, E_, E_, E_ }, // State_TRM
+    { E_, E_, CH, E_, E_, TT, E_, E_, E_, E_, E_, E_, E_, E_, E_, E_ }, // State_TRMChainB
+    { E_, E_, E_, E_, E_, TT, E_, E_, E_, E_, E_, E_, E_, E_, E_, E_ }, // State_TRMTrailer
+    { E_, CT, E_, E_, E_, E_, TE, E_, HT, HT, HT, HT, HT, HT, HT, HT }, // State_ChainA
+    { E_, E_, E_, CT, E_, E_, TE, E_, HT, HT, HT, HT, HT, HT, HT, HT }  // State_ChainB
+  };
+
+#undef E_
+#undef GH
+#undef DT
+#undef LD
+#undef LT
+#undef CH
+#undef CT
+#undef TT
+#undef TE
+#undef HT
+
+  /** state to fall back to after an unexpected word **/
+  
+  static const uint8_t DecodeRecover[State_End] = {
+    State_DRM, State_LTM, State_DRM, State_DRM, State_DRM, State_TRMChainB, State_TRMTrailer
+  };
+
+  template <typename V>
+  bool
+  Decoder::decode(V &visitor)
+  {
+
+    /** check if we have memory to decode **/
+    if (mPointer >= mWordsEnd) {
+#ifdef DECODE_VERBOSE
+      if (mVerbose) {
+	std::cout << "Warning: decode request exceeds memory size" << std::endl;
+      }
+#endif
+      return true;
+    }
+
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      std::cout << "-------- START DECODE EVENT ----------------------------------------" << std::endl;    
+    }
+#endif
+
+    /** not at the start of an event, skip to the next one **/
+    if (!IS_DRM_COMMON_HEADER(mPointer[0]) || !IS_DRM_GLOBAL_HEADER(mPointer[2]))
+      if (resync()) return true;
+
+    /** init decoder **/
+    auto start = mTimer.start();
+    auto sampled = mCounters.start();
+    mByteCounter = 0;
+    mHitCounter = 0;
+    visitor.onEventBegin();
+    
+    /** DRM Common Header, checked with the Global Header before the timer starts **/
+    auto header = mPointer;
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMCommonHeader = reinterpret_cast<DRMCommonHeader_t *>(mPointer);
+      auto Payload = DRMCommonHeader->Payload;
+      printf(" %08x DRM Common Header     (Payload=%d) \n", *mPointer, Payload);
+    }
+#endif
+    next32();
+
+    /** DRM Orbit Header **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMOrbitHeader = reinterpret_cast<DRMOrbitHeader_t *>(mPointer);
+      auto Orbit = DRMOrbitHeader->Orbit;
+      printf(" %08x DRM Orbit Header      (Orbit=%d) \n", *mPointer, Orbit);
+    }
+#endif
+    next32();    
+
+    /** DRM Global Header **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMGlobalHeader = reinterpret_cast<DRMGlobalHeader_t *>(mPointer);
+      auto DRMID = DRMGlobalHeader->DRMID;
+      printf(" %08x DRM Global Header     (DRMID=%d) \n", *mPointer, DRMID);
+    }
+#endif
+    next32();
+
+    /** DRM Status Header 1 **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMStatusHeader1 = reinterpret_cast<DRMStatusHeader1_t *>(mPointer);
+      auto ParticipatingSlotID = DRMStatusHeader1->ParticipatingSlotID;
+      auto CBit = DRMStatusHeader1->CBit;
+      auto DRMhSize = DRMStatusHeader1->DRMhSize;
+      printf(" %08x DRM Status Header 1   (ParticipatingSlotID=0x%03x, CBit=%d, DRMhSize=%d) \n", *mPointer, ParticipatingSlotID, CBit, DRMhSize);
+    }
+#endif
+    next32();
+
+    /** DRM Status Header 2 **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMStatusHeader2 = reinterpret_cast<DRMStatusHeader2_t *>(mPointer);
+      auto SlotEnableMask = DRMStatusHeader2->SlotEnableMask;
+      auto FaultID = DRMStatusHeader2->FaultID;
+      auto RTOBit = DRMStatusHeader2->RTOBit;
+      printf(" %08x DRM Status Header 2   (SlotEnableMask=0x%03x, FaultID=%d, RTOBit=%d) \n", *mPointer, SlotEnableMask, FaultID, RTOBit);
+    }
+#endif
+    next32();
+
+    /** DRM Status Header 3 **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      auto DRMStatusHeader3 = reinterpret_cast<DRMStatusHeader3_t *>(mPointer);
+      auto L0BCID = DRMStatusHeader3->L0BCID;
+      auto RunTimeInfo = DRMStatusHeader3->RunTimeInfo;
+      printf(" %08x DRM Status Header 3   (L0BCID=%d, RunTimeInfo=0x%03x) \n", *mPointer, L0BCID, RunTimeInfo);
+    }
+#endif
+    next32();
+
+    /** DRM Status Header 4 **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      printf(" %08x DRM Status Header 4 \n", *mPointer);
+    }
+#endif
+    next32();
+
+    /** DRM Status Header 5 **/
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      printf(" %08x DRM Status Header 5 \n", *mPointer);
+    }
+#endif
+    next32();
+    visitor.onDRMHeader(header);
+
+    /** loop over DRM payload **/
+    uint32_t SlotID = 0;
+    int itrm = 0, ichain = 0;
+    auto trmHeader = mPointer;
+    int state = State_DRM;
+    while (state != State_End) {
+      
+      auto action = DecodeTable[state][*mPointer >> 28];
+
+      /** TDC hit detected **/
+      if (action == Action_Hit) {
+	do {
+	  visitor.onHit(itrm, ichain, *mPointer);
+	  mHitCounter++;
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    auto TDCUnpackedHit = reinterpret_cast<TDCUnpackedHit_t *>(mPointer);
+	    auto HitTime = TDCUnpackedHit->HitTime;
+	    auto Chan = TDCUnpackedHit->Chan;
+	    auto TDCID = TDCUnpackedHit->TDCID;
+	    auto EBit = TDCUnpackedHit->EBit;
+	    auto PSBits = TDCUnpackedHit->PSBits;
+	    printf(" %08x TDC Hit               (HitTime=%d, Chan=%d, TDCID=%d, EBit=%d, PSBits=%d \n", *mPointer, HitTime, Chan, TDCID, EBit, PSBits);
+	  }
+#endif
+	  next32();
+	} while (IS_TDC_HIT(*mPointer));
+	continue;
+      }
+      
+      switch (action) {
+
+	/** TDC error detected **/
+      case Action_TDCError:
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  printf(" %08x TDC error \n", *mPointer);
+	}
+#endif
+	next32();
+	continue;
+
+	/** TRM chain header detected **/
+      case Action_ChainHeader:
+	if (GET_TRM_SLOTID(*mPointer) != SlotID) break;
+	ichain = *mPointer >> 29;
+	visitor.onChainHeader(itrm, ichain, *mPointer);
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  auto TRMChainHeader = reinterpret_cast<TRMChainHeader_t *>(mPointer);
+	  auto BunchID = TRMChainHeader->BunchID;
+	  printf(" %08x TRM Chain-%c Header    (SlotID=%d, BunchID=%d) \n", *mPointer, 'A' + ichain, SlotID, BunchID);
+	}
+#endif
+	next32();
+	/** chain not selected: skip its hits and TDC errors, the chain trailer is decoded **/
+	if (!(mChainMask & 1 << (2 * itrm + ichain))) {
+	  auto end = mPointer;
+	  while ((end = scan(end, mWordsEnd, 0, 7)) < mWordsEnd && IS_TDC_ERROR(*end))
+	    end++;
+	  mByteCounter += 4 * (end - mPointer);
+	  mPointer = end;
+	}
+	state = State_ChainA + ichain;
+	continue;
+
+	/** TRM chain trailer detected **/
+      case Action_ChainTrailer:
+	visitor.onChainTrailer(itrm, ichain, *mPointer);
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  auto TRMChainTrailer = reinterpret_cast<TRMChainTrailer_t *>(mPointer);
+	  auto EventCounter = TRMChainTrailer->EventCounter;
+	  printf(" %08x TRM Chain-%c Trailer   (SlotID=%d, EventCounter=%d) \n", *mPointer, 'A' + ichain, SlotID, EventCounter);
+	}
+#endif
+	next32();
+	state = State_TRMChainB + ichain;
+	continue;
+
+	/** LTM or TRM global header detected **/
+      case Action_GlobalHeader:
+	if (IS_LTM_GLOBAL_HEADER(*mPointer)) {
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x LTM Global Header \n", *mPointer);
+	  }
+#endif
+	  /** LTM not selected: jump to its trailer, look for it if the word count does not land there **/
+	  if (!(mSlotMask & 1)) {
+	    auto trailer = mPointer + GET_LTM_EVENTWORDS(*mPointer) - 1;
+	    if (trailer <= mPointer || trailer >= mWordsEnd || !IS_LTM_GLOBAL_TRAILER(*trailer))
+	      for (trailer = scan(mPointer + 1, mWordsEnd, 5, 5); trailer < mWordsEnd && !IS_LTM_GLOBAL_TRAILER(*trailer); )
+		trailer = scan(trailer + 1, mWordsEnd, 5, 5);
+	    mByteCounter += 4 * (trailer - mPointer);
+	    mPointer = trailer;
+	    if (mPointer < mWordsEnd) next32();
+	    state = State_DRM;
+	    continue;
+	  }
+	  next32();
+	  state = State_LTM;
+	  continue;
+	}
+	SlotID = GET_TRM_SLOTID(*mPointer);
+	if (SlotID < 3 || SlotID > 12) break;
+	/** TRM not selected: jump to its trailer, look for it if the word count does not land there **/
+	if (!(mSlotMask & 1 << (SlotID - 2))) {
+	  auto trailer = mPointer + GET_TRM_EVENTWORDS(*mPointer) - 1;
+	  if (trailer <= mPointer || trailer >= mWordsEnd || !IS_TRM_GLOBAL_TRAILER(*trailer))
+	    trailer = scan(mPointer + 1, mWordsEnd, 5, 5);
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x TRM Global Header     (SlotID=%d) not selected, %ld words skipped \n", *mPointer, SlotID, trailer - mPointer);
+	  }
+#endif
+	  mByteCounter += 4 * (trailer - mPointer);
+	  mPointer = trailer;
+	  /** anything else than the TRM trailer is left to the DRM level **/
+	  if (mPointer < mWordsEnd && IS_TRM_GLOBAL_TRAILER(*mPointer)) {
+	    next32();
+	    if (IS_FILLER(*mPointer)) next32();
+	  }
+	  state = State_DRM;
+	  continue;
+	}
+	itrm = SlotID - 3;
+	trmHeader = mPointer;
+	visitor.onTRMHeader(itrm, *mPointer);
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  auto TRMGlobalHeader = reinterpret_cast<TRMGlobalHeader_t *>(mPointer);
+	  auto EventWords = TRMGlobalHeader->EventWords;
+	  auto EventNumber = TRMGlobalHeader->EventNumber;
+	  auto EBit = TRMGlobalHeader->EBit;
+	  printf(" %08x TRM Global Header     (SlotID=%d, EventWords=%d, EventNumber=%d, EBit=%01x) \n", *mPointer, SlotID, EventWords, EventNumber, EBit);
+	}
+#endif
+	next32();
+	state = State_TRM;
+	continue;
+
+	/** TRM global trailer detected **/
+      case Action_TRMTrailer:
+	if (!IS_TRM_GLOBAL_TRAILER(*mPointer)) break;
+	visitor.onTRMTrailer(itrm, *mPointer);
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  auto TRMGlobalTrailer = reinterpret_cast<TRMGlobalTrailer_t *>(mPointer);
+	  auto EventCRC = TRMGlobalTrailer->EventCRC;
+	  auto LBit = TRMGlobalTrailer->LBit;
+	  printf(" %08x TRM Global Trailer    (SlotID=%d, EventCRC=%d, LBit=%d) \n", *mPointer, SlotID, EventCRC, LBit);
+	}
+#endif
+	/** from the TRM global header to the trailer, both included **/
+	if (mIntegrity)
+	  visitor.onTRMIntegrity(itrm, mPointer - trmHeader + 1);
+	next32();
+	
+	/** filler detected **/
+	if (IS_FILLER(*mPointer)) {
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x Filler \n", *mPointer);
+	  }
+#endif
+	  next32();
+	}
+	state = State_DRM;
+	continue;
+
+	/** DRM global trailer detected **/
+      case Action_DRMTrailer:
+	if (!IS_DRM_GLOBAL_TRAILER(*mPointer)) break;
+	visitor.onDRMTrailer(*mPointer);
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  auto DRMGlobalTrailer = reinterpret_cast<DRMGlobalTrailer_t *>(mPointer);
+	  auto LocalEventCounter = DRMGlobalTrailer->LocalEventCounter;
+	  printf(" %08x DRM Global Trailer    (LocalEventCounter=%d) \n", *mPointer, LocalEventCounter);
+	}
+#endif
+	/** from the DRM common header to the global trailer, both included, the first
+	    DRM word is the common header where the old format started with the global one **/
+	if (mIntegrity)
+	  visitor.onDRMIntegrity(mPointer - header + 1);
+	next32();
+	
+	/** filler detected **/
+	if (IS_FILLER(*mPointer)) {
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x Filler \n", *mPointer);
+	  }
+#endif
+	  next32();
+	}
+	state = State_End;
+	continue;
+
+	/** LTM global trailer or LTM data detected **/
+      case Action_LTMTrailer:
+	if (IS_LTM_GLOBAL_TRAILER(*mPointer)) {
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x LTM Global Trailer \n", *mPointer);
+	  }
+#endif
+	  next32();
+	  state = State_DRM;
+	  continue;
+	}
+	/** any other word is LTM data **/
+	[[fallthrough]];
+      case Action_LTMData:
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  printf(" %08x LTM data \n", *mPointer);
+	}
+#endif
+	next32();
+	if (mPointer < mWordsEnd) continue;
+	break;
+	
+      }
+
+      /** unexpected word: skip it and fall back to the enclosing block **/
+#ifdef DECODE_VERBOSE
+      if (mVerbose) {
+	if (state == State_ChainA || state == State_ChainB)
+	  printf(" %08x [ERROR] breaking TRM Chain-%c decode stream \n", *mPointer, 'A' + state - State_ChainA);
+	else if (state == State_DRM)
+	  printf(" %08x [ERROR] trying to recover DRM decode stream \n", *mPointer);
+	else
+	  printf(" %08x [ERROR] breaking TRM decode stream \n", *mPointer);
+      }
+#endif
+      if (state == State_ChainA || state == State_ChainB)
+	visitor.onChainError(itrm, ichain);
+      next32();
+      state = DecodeRecover[state];
+
+      /** only a DRM-level word can resume the DRM stream, skip to it, a new event ends this one **/
+      if (state == State_DRM) {
+	auto resume = scan(mPointer, mWordsEnd, 4, 5);
+#ifdef DECODE_VERBOSE
+	if (mVerbose && resume > mPointer) {
+	  printf(" [ERROR] skipped %ld bytes to recover DRM decode stream \n", 4 * (resume - mPointer));
+	}
+#endif
+	mByteCounter += 4 * (resume - mPointer);
+	skip(resume);
+	mPointer = resume;
+	if (mPointer < mWordsEnd && IS_DRM_COMMON_HEADER(mPointer[0]) && IS_DRM_GLOBAL_HEADER(mPointer[2])) {
+#ifdef DECODE_VERBOSE
+	  if (mVerbose) {
+	    printf(" %08x [ERROR] event truncated, next event found \n", *mPointer);
+	  }
+#endif
+	  visitor.onDecodeError();
+	  break;
+	}
+      }
+
+      /** ran past the end of the page payload **/
+      if (mPointer >= mWordsEnd) {
+#ifdef DECODE_VERBOSE
+	if (mVerbose) {
+	  printf(" [ERROR] event truncated at end of page \n");
+	}
+#endif
+	visitor.onDecodeError();
+	break;
+      }
+      
+    } /** end of loop over DRM payload **/
+    
+    visitor.onEventEnd();
+    
+#ifdef DECODE_VERBOSE
+    auto elapsed = mTimer.stop(start);
+#else
+    mTimer.stop(start);
+#endif
+    mCounters.stop(sampled, mByteCounter, mHitCounter);
+    
+    mIntegratedBytes += mByteCounter;
+    
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      std::cout << "-------- END DECODE EVENT ------------------------------------------"
+		<< " | " << mByteCounter << " bytes"
+		<< " | " << 1.e3  * Timer::seconds(elapsed) << " ms"
+		<< " | " << 1.e-6 * mIntegratedBytes / mTimer.getTime() << " MB/s (average)"
+		<< std::endl;
+    }
+#endif
+
+    return false;
+  }
+
+}}}
+
+#endif /** _TOF_RAW_DATA_DECODER_HXX **/
@@ -0,0 +1,251 @@
+#include "Demux.h"
+#include <iostream>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  char *
+  LinkSource::peek(long size)
+  {
+    /** pull pages from the input until this link has one, the others are
+	queued on their links. Only the decoder of an open event looks ahead,
+	if the link does not come back within the lookahead the event is cut **/
+    while (mQueue.empty()) {
+      long lookahead = mDemux->getLookahead();
+      if (lookahead > 0 && (long)(mDemux->getPulled() - mLast) >= lookahead) {
+	mCut++;
+	return nullptr;
+      }
+      if (mDemux->pull()) return nullptr;
+    }
+    auto &page = mQueue.front();
+    if (mBegin + size > page.Size) return nullptr;
+    return (page.Copy.empty() ? mDemux->held() : page.Copy.data()) + mBegin;
+  }
+
+  bool
+  LinkSource::consume(long size)
+  {
+    if (size == 0) return false;
+    if (mQueue.empty() || mBegin + size > mQueue.front().Size) return true;
+    mBegin += size;
+    if (mBegin < mQueue.front().Size) return false;
+    bool held = mQueue.front().Copy.empty();
+    mQueue.pop_front();
+    mBegin = 0;
+    return held && mDemux->release();
+  }
+
+  Demux::~Demux()
+  {
+    close();
+    if (mOwnSource) delete mSource;
+  }
+
+  bool
+  Demux::init()
+  {
+    if (mSource) {
+      std::cout << "Warning: a source was already allocated, cleaning" << std::endl;
+      if (mOwnSource) delete mSource;
+    }
+    mOwnSource = true;
+    mSource = Source::create(mSourceType, mSize, mDepth);
+    return false;
+  }
+
+  bool
+  Demux::open(std::string name)
+  {
+    /** streaming inputs cannot be mapped nor seeked **/
+    if (Source::isStream(name) && (mSourceType == Source_File || mSourceType == Source_Mapped)) {
+      mSourceType = Source_Stream;
+      if (mOwnSource) delete mSource;
+      mSource = nullptr;
+    }
+    if (!mSource) init();
+    if (mSource->isOpen()) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      close();
+    }
+    return mSource->open(name);
+  }
+
+  bool
+  Demux::close()
+  {
+    /** links are discovered again from the next input **/
+    for (auto &link : mLinks) {
+      mIntegratedBytes += link.second.Reader->mIntegratedBytes;
+      mSkippedBytes += link.second.Reader->getSkippedBytes();
+      mCutEvents += link.second.Input->getCut();
+      mTimer.merge(link.second.Reader->mTimer);
+      mCounters.merge(link.second.Reader->mCounters);
+      mStatistics.merge(link.second.Reader->getStatistics());
+      delete link.second.Reader;
+      delete link.second.Input;
+    }
+    mLinks.clear();
+    mOrder.clear();
+    mCurrent = nullptr;
+    mHolder = nullptr;
+    mHeldPage = nullptr;
+    mHeld = 0;
+    mPulled = 0;
+    if (mSource && mSource->isOpen())
+      return mSource->close();
+    return true;
+  }
+
+  bool
+  Demux::release()
+  {
+    long size = mHeld;
+    mHolder = nullptr;
+    mHeldPage = nullptr;
+    mHeld = 0;
+    return mSource->consume(size);
+  }
+
+  bool
+  Demux::pull()
+  {
+    if (!mSource || !mSource->isOpen()) return true;
+
+    /** the input moves on, the link of the page it is on keeps a copy **/
+    if (mHolder) {
+      mHolder->keep(mHeldPage);
+      if (release()) return true;
+    }
+
+    /** peek RDH and get packet size **/
+    auto rdh = reinterpret_cast<RDH_t *>(mSource->peek(sizeof(RDHWord_t)));
+    if (!rdh) return true;
+    long size = Decoder::pageSize(rdh);
+    if (size < 0) {
+      std::cout << "Warning: bad RDH packet size"
+		<< " (OffsetNewPacket=" << rdh->Word0.OffsetNewPacket
+		<< ", MemorySize=" << rdh->Word0.MemorySize
+		<< ", HeaderSize=" << rdh->Word0.HeaderSize << ")"
+		<< std::endl;
+      return true;
+    }
+    auto page = mSource->peek(size);
+    if (!page) return true;
+
+    /** queue it on its link, as a view until the input moves on **/
+    uint32_t link = linkID(reinterpret_cast<RDH_t *>(page));
+    getDecoder(link);
+    mHolder = mLinks[link].Input;
+    mHolder->hold(size, ++mPulled);
+    mHeldPage = page;
+    mHeld = size;
+    mOrder.push_back({link, mHolder->getPages()});
+    return false;
+  }
+
+  Decoder *
+  Demux::next()
+  {
+    /** the page of the previous decoder is decoded, the input can move on **/
+    if (mCurrent) mCurrent->release();
+    mCurrent = nullptr;
+    while (true) {
+      if (mOrder.empty() && pull()) {
+	if (mOwnSource && !mSource->isBad()) std::cout << "Nothing else to read" << std::endl;
+	return nullptr;
+      }
+      auto order = mOrder.front();
+      mOrder.pop_front();
+      auto &entry = mLinks[order.first];
+      /** already read by the link decoder, an empty page skipped by the
+	  continuation of an event, the pages after it are read in their turn **/
+      if (order.second <= entry.Reader->getPageCounter()) continue;
+      if (entry.Reader->read()) continue;
+      mCurrent = entry.Reader;
+      return mCurrent;
+    }
+  }
+
+  Decoder *
+  Demux::getDecoder(uint32_t link)
+  {
+    auto it = mLinks.find(link);
+    if (it != mLinks.end()) return it->second.Reader;
+#ifdef DECODE_VERBOSE
+    if (mVerbose) {
+      std::cout << "-------- NEW LINK --------------------------------------------------"
+		<< " | CruID=" << (link >> 16) << " FeeID=" << (link & 0xffff)
+		<< std::endl;
+    }
+#endif
+    Link_t entry;
+    entry.Input = new LinkSource(this);
+    entry.Reader = new Decoder();
+    entry.Reader->setVerbose(mVerbose);
+    entry.Reader->setSlotMask(mSlotMask);
+    entry.Reader->setChainMask(mChainMask);
+    entry.Reader->setCheck(mCheck);
+    entry.Reader->setIntegrity(mIntegrity);
+    entry.Reader->setStatistics(mFillStatistics);
+    entry.Reader->attach(entry.Input);
+    mLinks[link] = entry;
+    return entry.Reader;
+  }
+
+  double
+  Demux::getIntegratedBytes() const
+  {
+    double bytes = mIntegratedBytes;
+    for (auto &link : mLinks)
+      bytes += link.second.Reader->mIntegratedBytes;
+    return bytes;
+  }
+
+  uint64_t
+  Demux::getSkippedBytes() const
+  {
+    uint64_t bytes = mSkippedBytes;
+    for (auto &link : mLinks)
+      bytes += link.second.Reader->getSkippedBytes();
+    return bytes;
+  }
+
+  uint64_t
+  Demux::getCutEvents() const
+  {
+    uint64_t events = mCutEvents;
+    for (auto &link : mLinks)
+      events += link.second.Input->getCut();
+    return events;
+  }
+
+  Timer
+  Demux::getTimer() const
+  {
+    Timer timer = mTimer;
+    for (auto &link : mLinks)
+      timer.merge(link.second.Reader->mTimer);
+    return timer;
+  }
+
+  Counters
+  Demux::getCounters() const
+  {
+    Counters counters = mCounters;
+    for (auto &link : mLinks)
+      counters.merge(link.second.Reader->mCounters);
+    return counters;
+  }
+
+  Statistics
+  Demux::getStatistics() const
+  {
+    Statistics statistics = mStatistics;
+    for (auto &link : mLinks)
+      statistics.merge(link.second.Reader->getStatistics());
+    return statistics;
+  }
+
+}}}
@@ -0,0 +1,160 @@
+#ifndef _TOF_RAW_DATA_DEMUX_H
+#define _TOF_RAW_DATA_DEMUX_H
+
+#include <string>
+#include <cstdint>
+#include <map>
+#include <deque>
+#include <vector>
+#include <utility>
+#include "Raw/Source.h"
+#include "Raw/Decoder.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
+#include "Raw/Statistics.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  class Demux;
+
+  /** pages of a single link, pulled from the demultiplexer on demand, one
+      page at a time. The page the input is on is a view into the input, the
+      pages the input had to move past before their link read them are kept
+      as copies **/
+
+  class LinkSource : public Source {
+
+  public:
+
+    LinkSource(Demux *demux) : mDemux(demux) {};
+    ~LinkSource() {};
+
+    /** opened and closed through the demultiplexer **/
+    bool open(std::string name) {return false;};
+    bool close() {mQueue.clear(); mBegin = 0; return false;};
+    bool isOpen() const {return true;};
+    char *peek(long size);
+    bool consume(long size);
+
+    /** queue the page the input is on, as a view, ipage is its number in the input **/
+    void hold(long size, uint64_t ipage) {mQueue.push_back({std::vector<char>(), size}); mPages++; mLast = ipage;};
+    /** copy the page held as a view, the input moves past it **/
+    void keep(const char *page) {mQueue.back().Copy.assign(page, page + mQueue.back().Size);};
+    uint32_t getPages() const {return mPages;};
+    /** events left open when the lookahead ran out, cut short **/
+    uint32_t getCut() const {return mCut;};
+
+  protected:
+
+    struct Page_t {
+      std::vector<char> Copy; // empty while held as a view
+      long Size;
+    };
+
+    Demux *mDemux;
+    std::deque<Page_t> mQueue;
+    long mBegin = 0; // consumed in the front page
+    uint32_t mPages = 0;
+    uint64_t mLast = 0; // number of the last page in the input
+    uint32_t mCut = 0;
+
+  };
+
+  /** multi-link front end, routes CRU pages by FeeID/CruID to per-link decoders **/
+
+  class Demux {
+
+  public:
+
+    Demux() {};
+    ~Demux();
+
+    bool init();
+    bool open(std::string name);
+    bool close();
+    /** decoder of the link owning the next page in file order, page already read **/
+    Decoder *next();
+    /** read one page from the input and queue it on its link **/
+    bool pull();
+    /** the page the input is on, and its release once its link read it **/
+    char *held() const {return mHeldPage;};
+    uint64_t getPulled() const {return mPulled;};
+    bool release();
+
+    void setVerbose(bool val) {mVerbose = val;};
+    /** slot and chain selection, inline and integrity checks of the decoders, see Decoder **/
+    void setSlotMask(uint32_t val) {mSlotMask = val;};
+    void setChainMask(uint32_t val) {mChainMask = val;};
+    void setCheck(bool val) {mCheck = val;};
+    void setIntegrity(bool val) {mIntegrity = val;};
+    void setStatistics(bool val) {mFillStatistics = val;};
+    void setSize(long val) {mSize = val;};
+    void setSource(ESource_t val) {mSourceType = val;};
+    void setDepth(int val) {mDepth = val;};
+    /** pages after the last one of a link where its next one is looked for,
+	past them an event open on the link is cut short. 0, the default, waits
+	until the end of the input **/
+    void setLookahead(long val) {mLookahead = val;};
+    long getLookahead() const {return mLookahead;};
+    /** read pages from an external source, not owned **/
+    void attach(Source *val) {if (mOwnSource) delete mSource; mSource = val; mOwnSource = false;};
+
+    static uint32_t linkID(const RDH_t *rdh) {return rdh->Word0.CruID << 16 | getFeeID(rdh);};
+    long getNLinks() const {return mLinks.size();};
+    /** the input failed rather than ended **/
+    bool isBad() const {return mSource && mSource->isBad();};
+    /** per-link decoders are owned by the demultiplexer **/
+    Decoder *getDecoder(uint32_t link);
+
+    // benchmarks
+    double getIntegratedBytes() const;
+    Timer getTimer() const;
+    Counters getCounters() const;
+    uint64_t getSkippedBytes() const;
+    /** events cut short by the lookahead, data lost rather than corrupted **/
+    uint64_t getCutEvents() const;
+    /** run counters of the inline checks, all links **/
+    Statistics getStatistics() const;
+
+  protected:
+
+    struct Link_t {
+      LinkSource *Input;
+      Decoder *Reader;
+    };
+
+    Source *mSource = nullptr;
+    bool mOwnSource = true;
+    ESource_t mSourceType = Source_File;
+    int mDepth = 4;
+    long mSize = 8192;
+    bool mVerbose = false;
+    uint32_t mSlotMask = 0x7ff;
+    uint32_t mChainMask = 0xfffff;
+    bool mCheck = false;
+    bool mIntegrity = false;
+    bool mFillStatistics = false;
+
+    long mLookahead = 0;
+
+    std::map<uint32_t, Link_t> mLinks;
+    std::deque<std::pair<uint32_t, uint32_t>> mOrder; // link of each queued page and its number on the link, in file order
+    Decoder *mCurrent = nullptr;   // returned by next, its page is released by the next call
+    LinkSource *mHolder = nullptr; // link of the page the input is on
+    char *mHeldPage = nullptr;
+    long mHeld = 0;
+    uint64_t mPulled = 0;          // pages read from the input
+    double mIntegratedBytes = 0.; // from links already closed
+    uint64_t mSkippedBytes = 0;
+    uint64_t mCutEvents = 0;
+    Statistics mStatistics;       // from links already closed
+    Timer mTimer;
+    Counters mCounters;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_DEMUX_H **/
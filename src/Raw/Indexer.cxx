@@ -0,0 +1,326 @@
+#include "Indexer.h"
+#include "Decoder.h"
+#include "MappedSource.h"
+#include "RDH.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** sidecar file header **/
+  
+  struct IndexHeader_t
+  {
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t EntrySize;
+    uint64_t Entries;
+  };
+
+  static const char IndexMagic[8] = {'T', 'O', 'F', 'I', 'N', 'D', 'E', 'X'};
+  static const uint32_t IndexVersion = 2;
+  
+  long
+  Indexer::eventEnd(const uint32_t *words, long begin, long end, bool &closed)
+  {
+    /** skip the fixed DRM headers (the orbit is arbitrary data) and the LTM block,
+        DRM global trailer and optional filler close the event **/
+    long k = begin + 8;
+    for (; k < end && !IS_DRM_GLOBAL_TRAILER(words[k]); ++k) {
+      if (!IS_LTM_GLOBAL_HEADER(words[k])) continue;
+      for (++k; k < end && !IS_LTM_GLOBAL_TRAILER(words[k]); ++k);
+    }
+    if (k >= end) {
+      closed = false;
+      return end;
+    }
+    closed = true;
+    ++k;
+    if (k < end && IS_FILLER(words[k])) ++k;
+    return k;
+  }
+  
+  bool
+  Indexer::continues(long nopen, const char *page)
+  {
+    /** the fixed DRM header words of the open event may mimic a new one **/
+    return nopen < 8 || !starts(page);
+  }
+  
+  bool
+  Indexer::starts(const char *page)
+  {
+    /** a new event shows up as DRM common header, orbit, DRM global header **/
+    auto rdh = reinterpret_cast<const RDH_t *>(page);
+    auto gbt = reinterpret_cast<const uint32_t *>(page + rdh->Word0.HeaderSize);
+    if (rdh->Word0.MemorySize < rdh->Word0.HeaderSize + 16 + 2 * sizeof(uint32_t)) return false;
+    return IS_DRM_COMMON_HEADER(gbt[0]) && IS_DRM_GLOBAL_HEADER(gbt[4]);
+  }
+  
+  void
+  Indexer::walk(Walk_t &state, const char *page)
+  {
+    /** payload words as depadded by the decoder **/
+    auto rdh = reinterpret_cast<const RDH_t *>(page);
+    auto gbt = reinterpret_cast<const uint32_t *>(page + rdh->Word0.HeaderSize);
+    long bytes = (long)rdh->Word0.MemorySize - (long)rdh->Word0.HeaderSize;
+    long ngbt = bytes / 16;
+    long nwords = 2 * ngbt + (bytes % 16) / 4;
+    if (nwords > 2 * ngbt + 2) nwords = 2 * ngbt + 2;
+    auto word = [gbt](long j) {return gbt[4 * (j >> 1) + (j & 1)];};
+
+    /** the open event carried over, or a new start past a leftover filler **/
+    long j = 0;
+    if (!state.Open || !continues(state.Seen, page)) {
+      state.Open = false;
+      if (nwords && IS_FILLER(word(0))) j = 1;
+    }
+
+    /** each event as eventEnd, past the fixed DRM header words and over the LTM block **/
+    while (state.Open || (j < nwords && IS_DRM_COMMON_HEADER(word(j)))) {
+      if (!state.Open) {
+	state.Open = true;
+	state.InLTM = false;
+	state.Seen = 0;
+      }
+      for (; j < nwords; ++j, ++state.Seen) {
+	if (state.Seen < 8) continue;
+	auto w = word(j);
+	if (state.InLTM) state.InLTM = !IS_LTM_GLOBAL_TRAILER(w);
+	else if (IS_DRM_GLOBAL_TRAILER(w)) break;
+	else state.InLTM = IS_LTM_GLOBAL_HEADER(w);
+      }
+      if (j == nwords) return;
+      state.Open = false;
+      ++j;
+      if (j < nwords && IS_FILLER(word(j))) ++j;
+    }
+  }
+  
+  bool
+  Indexer::build(std::string name)
+  {
+    mIndex.clear();
+    mLinks.clear();
+    MappedSource source;
+    source.setReadAhead(67108864);
+    if (source.open(name)) return true;
+
+    /** walk pages as the decoder does, numbered from 1 as Decoder::getPageCounter **/
+    uint64_t offset = 0;
+    uint32_t npages = 0;
+    while (auto rdh = reinterpret_cast<const RDH_t *>(source.peek(sizeof(RDHWord_t)))) {
+      long size = Decoder::pageSize(rdh);
+      if (size < 0) {
+	std::cout << "Warning: bad RDH packet size at offset " << offset << ", index truncated" << std::endl;
+	break;
+      }
+      auto page = source.peek(size);
+      if (!page) break;
+      if (scan(page, offset, ++npages)) {
+	/** replay leaves the source past this page **/
+	while (replay(source, getFeeID(rdh) | rdh->Word0.CruID << 16, offset + size));
+	offset += size;
+	continue;
+      }
+      source.consume(size);
+      offset += size;
+    }
+    source.close();
+
+    /** events left open at the end of the file **/
+    for (auto &link : mLinks)
+      if (link.second.Event >= 0) close(link.second);
+    /** events found again by a replay come after the others **/
+    std::stable_sort(mIndex.begin(), mIndex.end(), [](const EventIndex_t &a, const EventIndex_t &b) {return a.Offset < b.Offset;});
+
+    if (mVerbose) {
+      std::cout << "Indexed " << mIndex.size() << " events in " << npages << " pages" << std::endl;
+    }
+    return false;
+  }
+
+  void
+  Indexer::open(Link_t &link, long word, uint64_t offset, uint32_t ipage, const RDH_t *rdh)
+  {
+    EventIndex_t entry = {};
+    entry.Offset = offset + rdh->Word0.HeaderSize + 16 * (word >> 1) + 4 * (word & 1);
+    entry.PageOffset = offset;
+    entry.Page = ipage;
+    entry.Word = word;
+    entry.FeeID = getFeeID(rdh);
+    link.Event = mIndex.size();
+    link.Seen = 0;
+    link.Words = 0;
+    link.Walk = false;
+    mIndex.push_back(entry);
+  }
+
+  bool
+  Indexer::replay(MappedSource &source, uint32_t key, uint64_t end)
+  {
+    /** the event again from its first word, the pages of the other links are already indexed **/
+    auto &link = mLinks[key];
+    auto &entry = mIndex[link.Event];
+    link.Seen = 0;
+    link.Walk = true;
+    uint64_t offset = entry.PageOffset;
+    uint32_t ipage = entry.Page;
+    long from = entry.Word;
+    bool again = false;
+    source.seek(offset);
+    while (offset < end) {
+      auto rdh = reinterpret_cast<const RDH_t *>(source.peek(sizeof(RDHWord_t)));
+      long size = Decoder::pageSize(rdh);
+      auto page = source.peek(size);
+      if ((getFeeID(rdh) | rdh->Word0.CruID << 16) == key) {
+	again = scan(page, offset, ipage, from);
+	from = -1;
+	/** a later event of the link missed its trailer too, walk again from it **/
+	if (again) break;
+      }
+      source.consume(size);
+      offset += size;
+      ipage++;
+    }
+    source.seek(end);
+    return again;
+  }
+  
+  void
+  Indexer::close(Link_t &link)
+  {
+    mIndex[link.Event].Length = link.Seen;
+    link.Event = -1;
+  }
+  
+  bool
+  Indexer::scan(const char *page, uint64_t offset, uint32_t ipage, long from)
+  {
+    /** payload words in place, the two valid words of each GBT word **/
+    auto rdh = reinterpret_cast<const RDH_t *>(page);
+    auto gbt = reinterpret_cast<const uint32_t *>(page + rdh->Word0.HeaderSize);
+    long bytes = (long)rdh->Word0.MemorySize - (long)rdh->Word0.HeaderSize;
+    if (bytes < 0) bytes = 0;
+    long ngbt = bytes / 16;
+    long nwords = 2 * ngbt + (bytes % 16) / 4;
+    if (nwords > 2 * ngbt + 2) nwords = 2 * ngbt + 2;
+    auto word = [gbt](long j) {return gbt[4 * (j >> 1) + (j & 1)];};
+
+    /** empty pages (e.g. HBF stop pages) carry nothing **/
+    if (nwords == 0) return false;
+
+    /** an open event continues in the next non-empty page of its link, as in Decoder::stitch **/
+    auto &link = mLinks[getFeeID(rdh) | rdh->Word0.CruID << 16];
+    long j = from;
+    if (from < 0) {
+      if (link.Event >= 0 && !continues(link.Seen, page)) {
+	/** a new event before the end given by EventWords, it missed its trailer **/
+	if (!link.Walk && link.Seen >= 6 && link.Seen < link.Words) return true;
+	close(link);
+      }
+      j = 0;
+      if (link.Event < 0 && IS_FILLER(word(0))) j = 1;
+    }
+
+    while (j < nwords) {
+
+      /** the next DRM common header + global header pair, as Decoder::resync,
+	  a header pair cut by the end of the page is taken as such **/
+      if (link.Event < 0) {
+	for (; j < nwords; ++j)
+	  if (IS_DRM_COMMON_HEADER(word(j)) && (j + 2 >= nwords || IS_DRM_GLOBAL_HEADER(word(j + 2)))) break;
+	if (j == nwords) break;
+	open(link, j, offset, ipage, rdh);
+      }
+
+      /** the fixed DRM header words, up to the L0BCID **/
+      auto &entry = mIndex[link.Event];
+      for (; j < nwords && link.Seen < 6; ++j, ++link.Seen) {
+	if (link.Seen == 1) entry.Orbit = word(j);
+	if (link.Seen == 2) link.Words = GET_DRM_EVENTWORDS(word(j));
+	if (link.Seen == 5) entry.L0BCID = GET_DRM_L0BCID(word(j));
+      }
+      if (link.Seen < 6) break;
+
+      /** EventWords short of the DRM headers and trailer, resync **/
+      if (link.Words < 9) link.Walk = true;
+
+      /** word by word past the fixed DRM header words to the next DRM common
+	  header + global header pair, as Decoder::resync after a bad event **/
+      if (link.Walk) {
+	for (; j < nwords; ++j, ++link.Seen)
+	  if (link.Seen >= 8 && IS_DRM_COMMON_HEADER(word(j)) && (j + 2 >= nwords || IS_DRM_GLOBAL_HEADER(word(j + 2)))) break;
+	if (j == nwords) break;
+	close(link);
+	continue;
+      }
+
+      /** then straight to the DRM global trailer **/
+      long skip = std::min<long>(link.Words - link.Seen, nwords - j);
+      j += skip;
+      link.Seen += skip;
+      if (link.Seen < link.Words) break;
+      if (!IS_DRM_GLOBAL_TRAILER(word(j - 1))) return true;
+      if (j < nwords && IS_FILLER(word(j))) {
+	j++;
+	link.Seen++;
+      }
+      close(link);
+    }
+    return false;
+  }
+  
+  bool
+  Indexer::write(std::string name) const
+  {
+    std::ofstream file(name.c_str(), std::fstream::out | std::fstream::binary);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    IndexHeader_t header;
+    std::memcpy(header.Magic, IndexMagic, sizeof(IndexMagic));
+    header.Version = IndexVersion;
+    header.EntrySize = sizeof(EventIndex_t);
+    header.Entries = mIndex.size();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(mIndex.data()), mIndex.size() * sizeof(EventIndex_t));
+    if (!file.good()) {
+      std::cerr << "Cannot write " << name << std::endl;
+      return true;
+    }
+    return false;
+  }
+
+  bool
+  Indexer::read(std::string name)
+  {
+    mIndex.clear();
+    std::ifstream file(name.c_str(), std::fstream::in | std::fstream::binary);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    IndexHeader_t header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file.good() || std::memcmp(header.Magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+	header.Version != IndexVersion || header.EntrySize != sizeof(EventIndex_t)) {
+      std::cerr << "Bad index file " << name << std::endl;
+      return true;
+    }
+    mIndex.resize(header.Entries);
+    file.read(reinterpret_cast<char *>(mIndex.data()), header.Entries * sizeof(EventIndex_t));
+    if ((uint64_t)file.gcount() != header.Entries * sizeof(EventIndex_t)) {
+      std::cerr << "Truncated index file " << name << std::endl;
+      mIndex.clear();
+      return true;
+    }
+    return false;
+  }
+  
+}}}
@@ -0,0 +1,81 @@
+#ifndef _TOF_RAW_DATA_INDEXER_H
+#define _TOF_RAW_DATA_INDEXER_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include "Raw/dataFormat.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  class MappedSource;
+
+  /** one-pass event indexer, walks RDH pages and jumps over each event with
+      its DRM EventWords, link by link, without decoding nor copying the payload.
+      A jump that does not land on the DRM global trailer is walked again word
+      by word up to the next event, where the decoder resyncs **/
+  
+  class Indexer {
+
+  public:
+    
+    Indexer() {};
+    ~Indexer() {};
+
+    /** scan a raw file **/
+    bool build(std::string name);
+    /** sidecar index file **/
+    bool write(std::string name) const;
+    bool read(std::string name);
+
+    void setVerbose(bool val) {mVerbose = val;};
+    const std::vector<EventIndex_t> &getIndex() const {return mIndex;};
+
+    /** default sidecar name for a raw file **/
+    static std::string sidecar(std::string name) {return name + ".idx";};
+    /** end of the event starting at begin in payload words, closed if its trailer was found **/
+    static long eventEnd(const uint32_t *words, long begin, long end, bool &closed);
+    /** whether a page of the same link continues an event open for nopen words **/
+    static bool continues(long nopen, const char *page);
+    /** whether a page starts with a new event, an event open before it on its link is not continued **/
+    static bool starts(const char *page);
+
+    /** the events of a link as Decoder::stitch walks them, page after page **/
+    struct Walk_t {
+      bool Open = false;  // the last event runs past the end of the last page
+      bool InLTM = false;
+      long Seen = 0;      // its words so far
+    };
+    /** walk a page with payload (MemorySize > HeaderSize) of the link **/
+    static void walk(Walk_t &state, const char *page);
+    
+  protected:
+
+    /** the event open on a link, by FeeID and CruID **/
+    struct Link_t {
+      long Event = -1;    // its index entry, -1 if none
+      uint32_t Seen = 0;  // payload words so far
+      uint32_t Words = 0; // DRM EventWords, from the DRM global header
+      bool Walk = false;  // EventWords found wrong, walk to the next event
+    };
+
+    /** true if an event did not land on its DRM global trailer, it is left
+	open to be walked again from its first word (from, -1 for a new page) **/
+    bool scan(const char *page, uint64_t offset, uint32_t ipage, long from = -1);
+    /** walk again the pages of a link up to end, from its open event **/
+    bool replay(MappedSource &source, uint32_t key, uint64_t end);
+    void open(Link_t &link, long word, uint64_t offset, uint32_t ipage, const RDH_t *rdh);
+    void close(Link_t &link);
+    
+    bool mVerbose = false;
+    std::vector<EventIndex_t> mIndex;
+    std::map<uint32_t, Link_t> mLinks;
+    
+  };
+  
+}}}
+
+#endif /** _TOF_RAW_DATA_INDEXER_H **/
@@ -0,0 +1,97 @@
+#include "MappedSource.h"
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  bool
+  MappedSource::open(std::string name)
+  {
+    if (mMap) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      close();
+    }
+    int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      std::cerr << "Cannot map " << name << std::endl;
+      ::close(fd);
+      return true;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+      std::cerr << "Cannot map " << name << std::endl;
+      return true;
+    }
+    mMap = (char *)map;
+    mSize = st.st_size;
+    mOffset = 0;
+    mAdvised = 0;
+    madvise(mMap, mSize, MADV_SEQUENTIAL);
+    advise();
+    return false;
+  }
+
+  bool
+  MappedSource::close()
+  {
+    if (!mMap) return true;
+    munmap(mMap, mSize);
+    mMap = nullptr;
+    mSize = mOffset = mAdvised = 0;
+    return false;
+  }
+
+  void
+  MappedSource::advise()
+  {
+    /** keep the kernel read-ahead one window in front of us **/
+    if (mReadAhead <= 0 || mAdvised >= mSize) return;
+    if (mOffset + mReadAhead / 2 < mAdvised) return;
+    long pagesize = sysconf(_SC_PAGESIZE);
+    long begin = (mOffset > mAdvised ? mOffset : mAdvised) / pagesize * pagesize;
+    long end = mOffset + mReadAhead;
+    if (end > mSize) end = mSize;
+    madvise(mMap + begin, end - begin, MADV_WILLNEED);
+    mAdvised = end;
+  }
+
+  char *
+  MappedSource::peek(long size)
+  {
+    if (!mMap || mOffset + size > mSize) return nullptr;
+    return mMap + mOffset;
+  }
+
+  bool
+  MappedSource::consume(long size)
+  {
+    if (!mMap || mOffset + size > mSize) return true;
+    mOffset += size;
+    advise();
+    return false;
+  }
+
+  bool
+  MappedSource::seek(long offset)
+  {
+    if (!mMap || offset < 0 || offset > mSize) return true;
+    mOffset = mAdvised = offset;
+    advise();
+    return false;
+  }
+
+}}}
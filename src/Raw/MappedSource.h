@@ -0,0 +1,44 @@
+#ifndef _TOF_RAW_DATA_MAPPEDSOURCE_H
+#define _TOF_RAW_DATA_MAPPEDSOURCE_H
+
+#include <string>
+#include <cstdint>
+#include "Raw/Source.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** memory-mapped page source, pages are windows into the mapping **/
+
+  class MappedSource : public Source {
+
+  public:
+
+    MappedSource() {};
+    ~MappedSource() { close(); };
+
+    bool open(std::string name);
+    bool close();
+    bool isOpen() const {return mMap != nullptr;};
+    char *peek(long size);
+    bool consume(long size);
+    bool seek(long offset);
+
+    void setReadAhead(long val) {mReadAhead = val;};
+
+  protected:
+
+    void advise();
+
+    char *mMap = nullptr;
+    long mSize = 0;
+    long mOffset = 0;
+    long mAdvised = 0;
+    long mReadAhead = 16777216;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_MAPPEDSOURCE_H **/
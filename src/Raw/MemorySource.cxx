@@ -0,0 +1,48 @@
+#include "MemorySource.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  void
+  MemorySource::set(char *data, long size)
+  {
+    mData = data;
+    mSize = size;
+    mBegin = 0;
+  }
+
+  bool
+  MemorySource::close()
+  {
+    if (!mData) return true;
+    mData = nullptr;
+    mSize = mBegin = 0;
+    return false;
+  }
+
+  char *
+  MemorySource::peek(long size)
+  {
+    if (!mData || mSize - mBegin < size)
+      return nullptr;
+    return mData + mBegin;
+  }
+
+  bool
+  MemorySource::consume(long size)
+  {
+    if (size > mSize - mBegin) return true;
+    mBegin += size;
+    return false;
+  }
+
+  bool
+  MemorySource::seek(long offset)
+  {
+    if (!mData || offset < 0 || offset > mSize) return true;
+    mBegin = offset;
+    return false;
+  }
+
+}}}
@@ -0,0 +1,41 @@
+#ifndef _TOF_RAW_DATA_MEMORYSOURCE_H
+#define _TOF_RAW_DATA_MEMORYSOURCE_H
+
+#include <string>
+#include <cstdint>
+#include "Raw/Source.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** page source over a block of memory owned by the caller **/
+
+  class MemorySource : public Source {
+
+  public:
+
+    MemorySource() {};
+    ~MemorySource() {};
+
+    /** nothing to open by name, use set **/
+    bool open(std::string name) {return true;};
+    bool close();
+    bool isOpen() const {return mData != nullptr;};
+    char *peek(long size);
+    bool consume(long size);
+    bool seek(long offset);
+
+    void set(char *data, long size);
+
+  protected:
+
+    char *mData = nullptr;
+    long mSize = 0;
+    long mBegin = 0;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_MEMORYSOURCE_H **/
@@ -0,0 +1,287 @@
+#include "ParallelDecoder.h"
+#include "MemorySource.h"
+#include "Indexer.h"
+#include <iostream>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  bool
+  ParallelDecoder::init()
+  {
+    if (mSource) {
+      std::cout << "Warning: a source was already allocated, cleaning" << std::endl;
+      delete mSource;
+    }
+    mSource = Source::create(mSourceType, mSize, mDepth);
+    return false;
+  }
+
+  bool
+  ParallelDecoder::open(std::string name)
+  {
+    /** streaming inputs cannot be mapped nor seeked **/
+    if (Source::isStream(name) && (mSourceType == Source_File || mSourceType == Source_Mapped)) {
+      mSourceType = Source_Stream;
+      delete mSource;
+      mSource = nullptr;
+    }
+    if (!mSource) init();
+    if (mSource->isOpen()) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      close();
+    }
+    return mSource->open(name);
+  }
+
+  bool
+  ParallelDecoder::close()
+  {
+    mScheduler.stop();
+    for (auto decoder : mDecoders)
+      delete decoder;
+    mDecoders.clear();
+    for (auto input : mInputs)
+      delete input;
+    mInputs.clear();
+    for (auto unit : mFree)
+      delete unit;
+    mFree.clear();
+    if (mSource && mSource->isOpen())
+      return mSource->close();
+    return true;
+  }
+
+  bool
+  ParallelDecoder::run(Process_t process, Sink_t sink)
+  {
+    if (!mSource || !mSource->isOpen()) {
+      std::cout << "Warning: no file is open" << std::endl;
+      return true;
+    }
+
+    /** start the workers, each one with its own decoder **/
+    if (mDecoders.empty()) {
+      for (int i = 0; i < mThreads; ++i) {
+	mInputs.push_back(new MemorySource());
+	mDecoders.push_back(new Decoder());
+	mDecoders.back()->setVerbose(mVerbose);
+	mDecoders.back()->setSlotMask(mSlotMask);
+	mDecoders.back()->setChainMask(mChainMask);
+	mDecoders.back()->setCheck(mCheck);
+	mDecoders.back()->setIntegrity(mIntegrity);
+	mDecoders.back()->setStatistics(mFillStatistics);
+	mDecoders.back()->attach(mInputs.back());
+      }
+      mScheduler.start(mThreads);
+    }
+    mInFlight = 0;
+    mOwners.clear();
+
+    /** cut the pages of each link in units before a page the decoder does
+	not stitch to the previous one, the events of each link are walked as
+	the decoder does. The unit of the next page to emit holds the others
+	back until it is cut, as soon as its link allows **/
+    struct Link_t {
+      Unit_t *Filling = nullptr;
+      Indexer::Walk_t Walk;
+    };
+    std::map<uint32_t, Link_t> links;
+    uint64_t npages = 0, since = 0;
+    long window = mWindow;
+    bool blocked = false;
+    Unit_t *waited = nullptr;
+    while (auto rdh = reinterpret_cast<RDH_t *>(mSource->peek(sizeof(RDHWord_t)))) {
+      long size = Decoder::pageSize(rdh);
+      if (size < 0) {
+	std::cout << "Warning: bad RDH packet size"
+		  << " (OffsetNewPacket=" << rdh->Word0.OffsetNewPacket
+		  << ", MemorySize=" << rdh->Word0.MemorySize
+		  << ", HeaderSize=" << rdh->Word0.HeaderSize << ")"
+		  << std::endl;
+	break;
+      }
+      auto page = mSource->peek(size);
+      if (!page) break;
+      rdh = reinterpret_cast<RDH_t *>(page);
+      uint32_t ilink = Demux::linkID(rdh);
+      auto &link = links[ilink];
+      auto &unit = link.Filling;
+      ++npages;
+      /** empty pages are skipped by the stitch, they stay with the unit before them **/
+      if (rdh->Word0.MemorySize > rdh->Word0.HeaderSize) {
+	bool boundary = !link.Walk.Open || !Indexer::continues(link.Walk.Seen, page);
+	if (unit && boundary && ((long)unit->Data.size() >= mUnitSize || (blocked && unit == mOwners.front()))) {
+	  blocked = submit(unit, process, sink);
+	  unit = nullptr;
+	}
+	Indexer::walk(link.Walk, page);
+      }
+      if (!unit) {
+	unit = newUnit();
+	unit->Link = ilink;
+      }
+      unit->Data.insert(unit->Data.end(), page, page + size);
+      unit->Pages++;
+      mOwners.push_back(unit);
+      mSource->consume(size);
+
+      /** or right away when no event is open on its link. With an event open
+	  the input goes on until its link comes back, the window only grows **/
+      while (blocked) {
+	auto front = mOwners.front();
+	auto &head = links[front->Link];
+	if (head.Walk.Open) {
+	  if (front != waited) {
+	    waited = front;
+	    since = npages;
+	  }
+	  if ((long)(npages - since) >= window) {
+	    std::cout << "Warning: link " << std::hex << front->Link << std::dec
+		      << " held the output back for " << window << " pages with an event open, window grown to " << 2 * window
+		      << std::endl;
+	    window *= 2;
+	  }
+	  break;
+	}
+	blocked = submit(head.Filling, process, sink);
+	head.Filling = nullptr;
+      }
+    }
+    for (auto &link : links)
+      if (link.second.Filling) submit(link.second.Filling, process, sink);
+
+    /** emit everything **/
+    drain(0, sink);
+    mScheduler.wait();
+    return false;
+  }
+
+  ParallelDecoder::Unit_t *
+  ParallelDecoder::newUnit()
+  {
+    /** the buffers of an emitted unit are already grown and mapped **/
+    if (mFree.empty()) return new Unit_t;
+    auto unit = mFree.back();
+    mFree.pop_back();
+    unit->Data.clear();
+    unit->Output.clear();
+    unit->Begins.clear();
+    unit->Pages = unit->Next = 0;
+    unit->Submitted = unit->Done = false;
+    return unit;
+  }
+
+  bool
+  ParallelDecoder::submit(Unit_t *unit, Process_t process, Sink_t sink)
+  {
+    /** a link has a home worker, others steal its units when idle **/
+    unit->Submitted = true;
+    mInFlight++;
+    mScheduler.push([this, unit, process] (int worker) {decode(worker, unit, process);}, unit->Link % mThreads);
+
+    /** bound the units in flight, emit those that are ready **/
+    return drain(2 * mThreads, sink);
+  }
+
+  bool
+  ParallelDecoder::drain(uint64_t limit, Sink_t sink)
+  {
+    /** the pages and the units in flight are only touched by the calling thread **/
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+      auto unit = mOwners.empty() ? nullptr : mOwners.front();
+      if (unit && unit->Done) {
+	lock.unlock();
+	/** the pages of this unit up to the first page of another one **/
+	long begin = unit->Begins[unit->Next];
+	for (; !mOwners.empty() && mOwners.front() == unit; mOwners.pop_front())
+	  unit->Next++;
+	long end = unit->Next < unit->Pages ? unit->Begins[unit->Next] : unit->Output.size();
+	if (end > begin) sink(unit->Output.data() + begin, end - begin);
+	if (unit->Next == unit->Pages) {
+	  mFree.push_back(unit);
+	  mInFlight--;
+	}
+	lock.lock();
+	continue;
+      }
+      if (mInFlight <= limit) return false;
+      /** the unit of the next page has not been submitted, do not wait for it **/
+      if (!unit || !unit->Submitted) return true;
+      mDone.wait(lock);
+    }
+  }
+
+  void
+  ParallelDecoder::decode(int worker, Unit_t *unit, Process_t process)
+  {
+    /** a unit starts with a new event on its link, the decoder starts afresh,
+	the pages continued by an event read before them have no output of their own **/
+    auto decoder = mDecoders[worker];
+    auto input = mInputs[worker];
+    input->set(unit->Data.data(), unit->Data.size());
+    uint32_t first = decoder->getPageCounter();
+    unit->Begins.reserve(unit->Pages);
+    while (true) {
+      decoder->release();
+      if (!input->peek(sizeof(RDHWord_t)) || decoder->read()) break;
+      unit->Begins.resize(decoder->getPageCounter() - first, unit->Output.size());
+      process(worker, *decoder, unit->Output);
+    }
+    unit->Begins.resize(unit->Pages, unit->Output.size());
+    decoder->close();
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      unit->Done = true;
+    }
+    mDone.notify_one();
+  }
+
+  double
+  ParallelDecoder::getIntegratedBytes() const
+  {
+    double bytes = 0.;
+    for (auto decoder : mDecoders)
+      bytes += decoder->mIntegratedBytes;
+    return bytes;
+  }
+
+  uint64_t
+  ParallelDecoder::getSkippedBytes() const
+  {
+    uint64_t bytes = 0;
+    for (auto decoder : mDecoders)
+      bytes += decoder->getSkippedBytes();
+    return bytes;
+  }
+
+  Timer
+  ParallelDecoder::getTimer() const
+  {
+    Timer timer;
+    for (auto decoder : mDecoders)
+      timer.merge(decoder->mTimer);
+    return timer;
+  }
+
+  Counters
+  ParallelDecoder::getCounters() const
+  {
+    Counters counters;
+    for (auto decoder : mDecoders)
+      counters.merge(decoder->mCounters);
+    return counters;
+  }
+
+  Statistics
+  ParallelDecoder::getStatistics() const
+  {
+    Statistics statistics;
+    for (auto decoder : mDecoders)
+      statistics.merge(decoder->getStatistics());
+    return statistics;
+  }
+
+}}}
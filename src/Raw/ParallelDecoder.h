@@ -0,0 +1,121 @@
+#ifndef _TOF_RAW_DATA_PARALLELDECODER_H
+#define _TOF_RAW_DATA_PARALLELDECODER_H
+
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <map>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "Raw/Source.h"
+#include "Raw/Decoder.h"
+#include "Raw/Demux.h"
+#include "Raw/MemorySource.h"
+#include "Raw/Scheduler.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** page-parallel decoding, the pages of each link are cut into units
+      before a page the decoder does not stitch to the previous one of its
+      link, the units are queued on the
+      worker that owns the link and idle workers steal them. The output of
+      each page is handed back in the order of the pages in the input, as the
+      Demux would, whatever the number of links **/
+
+  class ParallelDecoder {
+
+  public:
+
+    /** called on a worker for each page, the decoder has read it **/
+    typedef std::function<void (int worker, Decoder &decoder, std::vector<char> &output)> Process_t;
+    /** called on the calling thread with the output of consecutive pages, in order **/
+    typedef std::function<void (const char *output, long size)> Sink_t;
+
+    ParallelDecoder() {};
+    ~ParallelDecoder() { close(); delete mSource; };
+
+    bool init();
+    bool open(std::string name);
+    bool close();
+    bool run(Process_t process, Sink_t sink);
+
+    void setVerbose(bool val) {mVerbose = val;};
+    /** slot and chain selection, inline and integrity checks of the decoders, see Decoder **/
+    void setSlotMask(uint32_t val) {mSlotMask = val;};
+    void setChainMask(uint32_t val) {mChainMask = val;};
+    void setCheck(bool val) {mCheck = val;};
+    void setIntegrity(bool val) {mIntegrity = val;};
+    void setStatistics(bool val) {mFillStatistics = val;};
+    void setThreads(int val) {mThreads = val > 0 ? val : 1;};
+    void setUnitSize(long val) {mUnitSize = val;};
+    void setSize(long val) {mSize = val;};
+    void setSource(ESource_t val) {mSourceType = val;};
+    void setDepth(int val) {mDepth = val;};
+    void setStealing(bool val) {mScheduler.setStealing(val);};
+    /** pages read while the unit of the next page to emit holds the others
+	back with an event open, past them a warning and the window doubles, a
+	unit is never cut in the middle of an event **/
+    void setWindow(long val) {mWindow = val;};
+    int getThreads() const {return mThreads;};
+    /** the input failed rather than ended **/
+    bool isBad() const {return mSource && mSource->isBad();};
+    const Scheduler &getScheduler() const {return mScheduler;};
+
+    // benchmarks
+    double getIntegratedBytes() const;
+    Timer getTimer() const;
+    Counters getCounters() const;
+    uint64_t getSkippedBytes() const;
+    /** run counters of the inline checks, all workers **/
+    Statistics getStatistics() const;
+
+  protected:
+
+    struct Unit_t {
+      uint32_t Link;
+      std::vector<char> Data;
+      long Pages = 0;
+      std::vector<char> Output;
+      std::vector<long> Begins; // output of each page
+      long Next = 0;            // next page to emit
+      bool Submitted = false;
+      bool Done = false;        // guarded by the mutex
+    };
+
+    Unit_t *newUnit();
+    void decode(int worker, Unit_t *unit, Process_t process);
+    bool submit(Unit_t *unit, Process_t process, Sink_t sink);
+    bool drain(uint64_t limit, Sink_t sink);
+
+    Source *mSource = nullptr;
+    ESource_t mSourceType = Source_File;
+    int mDepth = 4;
+    long mSize = 8192;
+    long mUnitSize = 1048576;
+    long mWindow = 4096;
+    int mThreads = 1;
+    bool mVerbose = false;
+    uint32_t mSlotMask = 0x7ff;
+    uint32_t mChainMask = 0xfffff;
+    bool mCheck = false;
+    bool mIntegrity = false;
+    bool mFillStatistics = false;
+
+    Scheduler mScheduler;
+    std::vector<Decoder *> mDecoders;     // one per worker, reused unit after unit
+    std::vector<MemorySource *> mInputs;  // one per worker, a view on its unit
+    std::mutex mMutex;
+    std::condition_variable mDone;
+    std::deque<Unit_t *> mOwners;         // unit of each page not emitted yet, in input order
+    uint64_t mInFlight = 0;               // submitted, not emitted yet
+    std::vector<Unit_t *> mFree;          // emitted, their buffers kept for the next ones
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_PARALLELDECODER_H **/
@@ -0,0 +1,53 @@
+#ifndef _TOF_RAW_DATA_RDH_H
+#define _TOF_RAW_DATA_RDH_H
+
+#include <cstdint>
+#include "Raw/dataFormat.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** RDH fields by header version, rdh points to the first of the 128-bit
+      header words. HeaderVersion, HeaderSize, OffsetNewPacket, MemorySize,
+      PacketCounter and CruID sit in the same place in every version and are
+      read through Word0. A new version is a new specialisation **/
+
+  /** i-th 128-bit header word, RDH_t is wider than that and can't be indexed **/
+  inline const RDH_t *getRDHWord(const RDH_t *rdh, int i) {
+    return reinterpret_cast<const RDH_t *>(reinterpret_cast<const RDHWord_t *>(rdh) + i);
+  }
+
+  template <int V> struct RDHLayout;
+
+  template <> struct RDHLayout<4> {
+    static bool accepts(uint32_t version) {return version <= 4;};
+    static uint32_t FeeID(const RDH_t *rdh) {return getRDHWord(rdh, 0)->Word0.FeeID;};
+    static uint32_t Orbit(const RDH_t *rdh) {return getRDHWord(rdh, 1)->Word1.TrgOrbit;};
+    static uint32_t BC(const RDH_t *rdh) {return getRDHWord(rdh, 2)->Word2.TrgBC;};
+    static uint32_t TrgType(const RDH_t *rdh) {return getRDHWord(rdh, 2)->Word2.TrgType;};
+    static uint32_t StopBit(const RDH_t *rdh) {return getRDHWord(rdh, 3)->Word3.StopBit;};
+    static uint32_t PagesCounter(const RDH_t *rdh) {return getRDHWord(rdh, 3)->Word3.PagesCounter;};
+  };
+
+  template <> struct RDHLayout<6> {
+    static bool accepts(uint32_t version) {return version >= 5;};
+    static uint32_t FeeID(const RDH_t *rdh) {return getRDHWord(rdh, 0)->V6Word0.FeeID;};
+    static uint32_t Orbit(const RDH_t *rdh) {return getRDHWord(rdh, 1)->V6Word1.Orbit;};
+    static uint32_t BC(const RDH_t *rdh) {return getRDHWord(rdh, 1)->V6Word1.BC;};
+    static uint32_t TrgType(const RDH_t *rdh) {return getRDHWord(rdh, 2)->V6Word2.TrgType;};
+    static uint32_t StopBit(const RDH_t *rdh) {return getRDHWord(rdh, 2)->V6Word2.StopBit;};
+    static uint32_t PagesCounter(const RDH_t *rdh) {return getRDHWord(rdh, 2)->V6Word2.PagesCounter;};
+  };
+
+  /** newest version with a known layout **/
+  static const uint32_t RDHLatestVersion = 7;
+
+  /** for code looking at single pages of any version (routing, indexing) **/
+  inline uint32_t getFeeID(const RDH_t *rdh) {
+    return RDHLayout<4>::accepts(rdh->Word0.HeaderVersion) ? RDHLayout<4>::FeeID(rdh) : RDHLayout<6>::FeeID(rdh);
+  }
+
+}}}
+
+#endif /** _TOF_RAW_DATA_RDH_H **/
@@ -0,0 +1,174 @@
+#include "Scheduler.h"
+#include <iostream>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  bool
+  Scheduler::start(int nworkers)
+  {
+    if (!mWorkers.empty()) {
+      std::cout << "Warning: scheduler already started" << std::endl;
+      return true;
+    }
+    if (nworkers < 1) nworkers = 1;
+    mStop = false;
+    mQueued = mPending = mNext = 0;
+    for (int i = 0; i < nworkers; ++i)
+      mWorkers.push_back(new Worker_t);
+    for (int i = 0; i < nworkers; ++i)
+      mWorkers[i]->Thread = std::thread(&Scheduler::loop, this, i);
+    return false;
+  }
+
+  bool
+  Scheduler::stop()
+  {
+    if (mWorkers.empty()) return true;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWake.notify_all();
+    /** others may still look into a deque until they are all gone **/
+    for (auto worker : mWorkers)
+      worker->Thread.join();
+    for (auto worker : mWorkers)
+      delete worker;
+    mWorkers.clear();
+    return false;
+  }
+
+  void
+  Scheduler::push(Task_t task, int worker, long key)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (worker < 0) worker = mNext++ % mWorkers.size();
+      mPending++;
+      /** a task with the same key is queued or running, wait behind it, not counted as queued **/
+      if (key >= 0) {
+	auto it = mStrands.find(key);
+	if (it != mStrands.end()) {
+	  it->second.push_back({std::move(task), key});
+	  return;
+	}
+	mStrands[key];
+      }
+    }
+    enqueue({std::move(task), key}, worker % mWorkers.size());
+  }
+
+  void
+  Scheduler::enqueue(Entry_t &&entry, int worker)
+  {
+    auto &target = *mWorkers[worker];
+    /** count it with the deque held, a count is a task that can be taken
+        and a sleeper that wakes up on it finds it **/
+    {
+      std::lock_guard<std::mutex> lock(target.Mutex);
+      target.Tasks.push_back(std::move(entry));
+      std::lock_guard<std::mutex> count(mMutex);
+      target.Queued++;
+      mQueued++;
+    }
+    /** the owner may be asleep while others are not, wake everybody **/
+    mWake.notify_all();
+  }
+
+  void
+  Scheduler::wait()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] {return mPending == 0;});
+  }
+
+  bool
+  Scheduler::pop(int worker, Entry_t &entry)
+  {
+    /** take the task off its deque and its count at once, always the deque
+        mutex first **/
+    auto take = [this, &entry](Worker_t &from, bool front) {
+      if (front) {
+	entry = std::move(from.Tasks.front());
+	from.Tasks.pop_front();
+      }
+      else {
+	entry = std::move(from.Tasks.back());
+	from.Tasks.pop_back();
+      }
+      std::lock_guard<std::mutex> count(mMutex);
+      from.Queued--;
+      mQueued--;
+    };
+
+    /** own deque first, oldest task **/
+    {
+      auto &self = *mWorkers[worker];
+      std::lock_guard<std::mutex> lock(self.Mutex);
+      if (!self.Tasks.empty()) {
+	take(self, true);
+	return true;
+      }
+    }
+    if (!mStealing) return false;
+
+    /** steal the newest task of the next worker that has any **/
+    int n = mWorkers.size();
+    for (int i = 1; i < n; ++i) {
+      auto &victim = *mWorkers[(worker + i) % n];
+      std::lock_guard<std::mutex> lock(victim.Mutex);
+      if (!victim.Tasks.empty()) {
+	take(victim, false);
+	mWorkers[worker]->Stolen++;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  Scheduler::loop(int worker)
+  {
+    auto &self = *mWorkers[worker];
+    Entry_t entry;
+    while (true) {
+      if (!pop(worker, entry)) {
+	/** sleep until something is queued that this worker can reach, the
+	    counts move with the deques so a wake-up is never for nothing **/
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWake.wait(lock, [this, &self] {return mStop || (mStealing ? mQueued : self.Queued) > 0;});
+	if (mStop && (mStealing ? mQueued : self.Queued) == 0) return;
+	continue;
+      }
+
+      auto start = self.Busy.start();
+      entry.Task(worker);
+      self.Busy.stop(start);
+      self.Executed++;
+      entry.Task = nullptr;
+
+      /** release the key, its next task goes to this worker **/
+      bool idle, next = false;
+      Entry_t backlog;
+      {
+	std::lock_guard<std::mutex> lock(mMutex);
+	idle = --mPending == 0;
+	if (entry.Key >= 0) {
+	  auto it = mStrands.find(entry.Key);
+	  if (it->second.empty())
+	    mStrands.erase(it);
+	  else {
+	    backlog = std::move(it->second.front());
+	    it->second.pop_front();
+	    next = true;
+	  }
+	}
+      }
+      if (next) enqueue(std::move(backlog), worker);
+      if (idle) mIdle.notify_all();
+    }
+  }
+
+}}}
@@ -0,0 +1,84 @@
+#ifndef _TOF_RAW_DATA_SCHEDULER_H
+#define _TOF_RAW_DATA_SCHEDULER_H
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Raw/Timer.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** work-stealing task scheduler, every worker runs the tasks of its own
+      deque from the front and, when it runs dry, steals from the back of
+      the others. Tasks pushed with the same key (e.g. a crate) run one at
+      a time in the order they were pushed, the next one is queued once the
+      previous one has run **/
+
+  class Scheduler {
+
+  public:
+
+    typedef std::function<void (int worker)> Task_t;
+
+    Scheduler() {};
+    ~Scheduler() { stop(); };
+
+    bool start(int nworkers);
+    bool stop();
+    /** queue a task on a worker, -1 for round robin, key >= 0 keeps order **/
+    void push(Task_t task, int worker = -1, long key = -1);
+    /** wait until all the tasks queued so far have run **/
+    void wait();
+
+    void setStealing(bool val) {mStealing = val;};
+    int getNWorkers() const {return mWorkers.size();};
+
+    // benchmarks
+    uint64_t getExecuted(int worker) const {return mWorkers[worker]->Executed;};
+    uint64_t getStolen(int worker) const {return mWorkers[worker]->Stolen;};
+    double getBusyTime(int worker) const {return mWorkers[worker]->Busy.getTime();};
+
+  protected:
+
+    struct Entry_t {
+      Task_t Task;
+      long Key;
+    };
+
+    struct Worker_t {
+      std::mutex Mutex;
+      std::deque<Entry_t> Tasks;
+      std::thread Thread;
+      uint64_t Queued = 0;   // guarded by the scheduler mutex, within the deque mutex
+      uint64_t Executed = 0;
+      uint64_t Stolen = 0;
+      Timer Busy;
+    };
+
+    void enqueue(Entry_t &&entry, int worker);
+    bool pop(int worker, Entry_t &entry);
+    void loop(int worker);
+
+    std::vector<Worker_t *> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mIdle;
+    uint64_t mQueued = 0;  // waiting in the deques, counted with the deque they are in
+    uint64_t mPending = 0; // queued or running
+    uint64_t mNext = 0;    // round robin
+    std::map<long, std::deque<Entry_t>> mStrands; // keys with a task queued or running, and their backlog
+    bool mStealing = true;
+    bool mStop = false;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_SCHEDULER_H **/
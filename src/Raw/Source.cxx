@@ -0,0 +1,156 @@
+#include "Source.h"
+#include "MappedSource.h"
+#include "AsyncSource.h"
+#include "StreamSource.h"
+#include <iostream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  Source *
+  Source::create(ESource_t type, long size, int depth)
+  {
+    switch (type) {
+    case Source_Mapped:
+      return new MappedSource();
+    case Source_Async:
+      return new AsyncSource(size, depth);
+    case Source_Stream:
+      return new StreamSource(size);
+    default:
+      return new FileSource(size);
+    }
+  }
+
+  bool
+  Source::isStream(std::string name)
+  {
+    if (name == "-" || name.compare(0, 5, "unix:") == 0) return true;
+    struct stat st;
+    if (stat(name.c_str(), &st) != 0) return false;
+    return S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode);
+  }
+
+  int
+  Source::openStream(std::string name)
+  {
+    /** standard input **/
+    if (name == "-")
+      return STDIN_FILENO;
+    
+    /** local socket, connect to the writer **/
+    if (name.compare(0, 5, "unix:") == 0) {
+      std::string path = name.substr(5);
+      struct sockaddr_un addr;
+      if (path.size() >= sizeof(addr.sun_path)) {
+	std::cerr << "Socket path too long " << path << std::endl;
+	return -1;
+      }
+      int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0) {
+	std::cerr << "Cannot create socket" << std::endl;
+	return -1;
+      }
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+      if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+	std::cerr << "Cannot connect " << path << std::endl;
+	::close(fd);
+	return -1;
+      }
+      return fd;
+    }
+
+    /** fifo or regular file **/
+    int fd = ::open(name.c_str(), O_RDONLY);
+    if (fd < 0)
+      std::cerr << "Cannot open " << name << std::endl;
+    return fd;
+  }
+
+  bool
+  FileSource::open(std::string name)
+  {
+    if (mFile.is_open()) {
+      std::cout << "Warning: a file was already open, closing" << std::endl;
+      mFile.close();
+    }
+    mFile.open(name.c_str(), std::fstream::in | std::fstream::binary);
+    if (!mFile.is_open()) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    mBegin = mEnd = 0;
+    return false;
+  }
+
+  bool
+  FileSource::close()
+  {
+    if (mFile.is_open()) {
+      mFile.close();
+      return false;
+    }
+    return true;
+  }
+
+  char *
+  FileSource::peek(long size)
+  {
+    /** already buffered **/
+    if (mEnd - mBegin >= size)
+      return mBuffer + mBegin;
+
+    /** make room: move pending bytes to front, grow if needed **/
+    if (!mBuffer || mBegin + size > mCapacity) {
+      char *buffer = mBuffer;
+      if (!mBuffer || size > mCapacity) {
+	if (size > mCapacity) mCapacity = size;
+	buffer = new char[mCapacity];
+      }
+      if (mEnd > mBegin)
+	std::memmove(buffer, mBuffer + mBegin, mEnd - mBegin);
+      if (buffer != mBuffer) {
+	delete [] mBuffer;
+	mBuffer = buffer;
+      }
+      mEnd -= mBegin;
+      mBegin = 0;
+    }
+
+    /** read what is missing **/
+    mFile.read(mBuffer + mEnd, size - (mEnd - mBegin));
+    mEnd += mFile.gcount();
+    if (mEnd - mBegin < size)
+      return nullptr;
+    return mBuffer + mBegin;
+  }
+
+  bool
+  FileSource::consume(long size)
+  {
+    if (size > mEnd - mBegin) return true;
+    mBegin += size;
+    if (mBegin == mEnd) mBegin = mEnd = 0;
+    return false;
+  }
+
+  bool
+  FileSource::seek(long offset)
+  {
+    if (!mFile.is_open()) return true;
+    mFile.clear();
+    mFile.seekg(offset);
+    mBegin = mEnd = 0;
+    return !mFile.good();
+  }
+
+}}}
@@ -0,0 +1,80 @@
+#ifndef _TOF_RAW_DATA_SOURCE_H
+#define _TOF_RAW_DATA_SOURCE_H
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** source types **/
+
+  enum ESource_t {
+    Source_File,
+    Source_Mapped,
+    Source_Async,
+    Source_Stream,
+  };
+
+  /** abstract page source **/
+
+  class Source {
+
+  public:
+
+    Source() {};
+    virtual ~Source() {};
+
+    virtual bool open(std::string name) = 0;
+    virtual bool close() = 0;
+    virtual bool isOpen() const = 0;
+
+    /** pointer to the next size bytes, nullptr if not available **/
+    virtual char *peek(long size) = 0;
+    /** release size bytes, pointers from peek are invalidated **/
+    virtual bool consume(long size) = 0;
+    /** restart reading at a file offset, streaming sources cannot seek **/
+    virtual bool seek(long offset) {return true;};
+    /** the input failed, as opposed to ended, when peek returned nullptr **/
+    virtual bool isBad() const {return false;};
+
+    /** a new source of the given type, owned by the caller, size and depth go to the buffered ones **/
+    static Source *create(ESource_t type, long size = 8192, int depth = 4);
+    /** streaming inputs: "-" (stdin), "unix:<path>" (socket), fifo **/
+    static bool isStream(std::string name);
+    static int openStream(std::string name);
+    
+  };
+
+  /** ifstream page source **/
+
+  class FileSource : public Source {
+
+  public:
+
+    FileSource(long size = 8192) : mCapacity(size) {};
+    ~FileSource() { close(); delete [] mBuffer; };
+
+    bool open(std::string name);
+    bool close();
+    bool isOpen() const {return mFile.is_open();};
+    bool isBad() const {return mFile.bad();};
+    char *peek(long size);
+    bool consume(long size);
+    bool seek(long offset);
+
+  protected:
+
+    std::ifstream mFile;
+    char *mBuffer = nullptr;
+    long mCapacity;
+    long mBegin = 0;
+    long mEnd = 0;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_SOURCE_H **/
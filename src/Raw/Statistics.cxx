@@ -0,0 +1,168 @@
+#include "Statistics.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** binary dump header **/
+
+  struct StatisticsHeader_t
+  {
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t EntrySize;
+    uint64_t Entries;
+  };
+
+  static const char StatisticsMagic[8] = {'T', 'O', 'F', 'S', 'T', 'A', 'T', 'S'};
+  static const uint32_t StatisticsVersion = 1;
+  static const long CacheLine = 64;
+
+  static_assert(sizeof(CrateCounterData_t) % CacheLine == 0, "crate counters not on whole cache lines");
+
+  Statistics::Statistics() :
+    mBuffer((Crates + 1) * sizeof(CrateCounterData_t))
+  {
+    /** first crate at the first cache line boundary of the buffer **/
+    auto address = reinterpret_cast<uintptr_t>(mBuffer.data());
+    mCrates = reinterpret_cast<CrateCounterData_t *>(mBuffer.data() + (CacheLine - address % CacheLine) % CacheLine);
+    reset();
+  }
+
+  Statistics &
+  Statistics::operator=(const Statistics &other)
+  {
+    if (this == &other) return *this;
+    std::memcpy(mCrates, other.mCrates, Crates * sizeof(CrateCounterData_t));
+    return *this;
+  }
+
+  void
+  Statistics::merge(const Statistics &other)
+  {
+    /** all counters are uint32_t, DRMID is the same on both sides **/
+    const int N = sizeof(CrateCounterData_t) / sizeof(uint32_t);
+    for (int icrate = 0; icrate < Crates; ++icrate) {
+      if (!other.mCrates[icrate].DRM.ExpectedData) continue;
+      auto to = reinterpret_cast<uint32_t *>(&mCrates[icrate]);
+      auto from = reinterpret_cast<const uint32_t *>(&other.mCrates[icrate]);
+      for (int i = 1; i < N; ++i)
+	to[i] += from[i];
+    }
+  }
+
+  bool
+  Statistics::operator==(const Statistics &other) const
+  {
+    return std::memcmp(mCrates, other.mCrates, Crates * sizeof(CrateCounterData_t)) == 0;
+  }
+
+  void
+  Statistics::reset()
+  {
+    std::memset(mCrates, 0, Crates * sizeof(CrateCounterData_t));
+    for (int icrate = 0; icrate < Crates; ++icrate)
+      mCrates[icrate].DRMID = icrate;
+  }
+
+  bool
+  Statistics::write(std::string name) const
+  {
+    std::ofstream file(name.c_str(), std::fstream::out | std::fstream::binary);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    StatisticsHeader_t header;
+    std::memcpy(header.Magic, StatisticsMagic, sizeof(StatisticsMagic));
+    header.Version = StatisticsVersion;
+    header.EntrySize = sizeof(CrateCounterData_t);
+    header.Entries = 0;
+    for (int icrate = 0; icrate < Crates; ++icrate)
+      if (mCrates[icrate].DRM.ExpectedData) header.Entries++;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (int icrate = 0; icrate < Crates; ++icrate)
+      if (mCrates[icrate].DRM.ExpectedData)
+	file.write(reinterpret_cast<const char *>(&mCrates[icrate]), sizeof(CrateCounterData_t));
+    if (!file.good()) {
+      std::cerr << "Cannot write " << name << std::endl;
+      return true;
+    }
+    return false;
+  }
+
+  bool
+  Statistics::read(std::string name)
+  {
+    reset();
+    std::ifstream file(name.c_str(), std::fstream::in | std::fstream::binary);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open " << name << std::endl;
+      return true;
+    }
+    StatisticsHeader_t header;
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!file.good() || std::memcmp(header.Magic, StatisticsMagic, sizeof(StatisticsMagic)) != 0 ||
+	header.Version != StatisticsVersion || header.EntrySize != sizeof(CrateCounterData_t) || header.Entries > Crates) {
+      std::cerr << "Bad statistics file " << name << std::endl;
+      return true;
+    }
+    for (uint64_t ientry = 0; ientry < header.Entries; ++ientry) {
+      CrateCounterData_t crate;
+      file.read(reinterpret_cast<char *>(&crate), sizeof(crate));
+      if (file.gcount() != sizeof(crate) || crate.DRMID >= Crates) {
+	std::cerr << "Truncated statistics file " << name << std::endl;
+	reset();
+	return true;
+      }
+      mCrates[crate.DRMID] = crate;
+    }
+    return false;
+  }
+
+  /** something off in a chain, or in a TRM and its chains **/
+  static bool
+  faulty(const TRMChainCounterData_t &chain)
+  {
+    return chain.ExpectedData != chain.DetectedData || chain.EventCounterMismatch || chain.BadStatus || chain.BunchIDMismatch;
+  }
+
+  static bool
+  faulty(const TRMCounterData_t &trm, const TRMChainCounterData_t *chains)
+  {
+    return trm.ExpectedData != trm.DetectedData || trm.EventCounterMismatch || trm.EventWordsMismatch || faulty(chains[0]) || faulty(chains[1]);
+  }
+
+  void
+  Statistics::print(std::ostream &out) const
+  {
+    /** a line per crate, the TRMs and chains only when something is off **/
+    char line[256];
+    for (int icrate = 0; icrate < Crates; ++icrate) {
+      auto &crate = mCrates[icrate];
+      if (!crate.DRM.ExpectedData) continue;
+      snprintf(line, sizeof(line), " crate %3d: events %u | detected %u | event words %u",
+	       crate.DRMID, crate.DRM.ExpectedData, crate.DRM.DetectedData, crate.DRM.EventWordsMismatch);
+      out << line << std::endl;
+      for (int itrm = 0; itrm < 10; ++itrm) {
+	auto &trm = crate.TRM[itrm];
+	if (!faulty(trm, crate.TRMChain[itrm])) continue;
+	snprintf(line, sizeof(line), "   slot %2d: expected %u | detected %u | event counter %u | event words %u",
+		 itrm + 3, trm.ExpectedData, trm.DetectedData, trm.EventCounterMismatch, trm.EventWordsMismatch);
+	out << line << std::endl;
+	for (int ichain = 0; ichain < 2; ++ichain) {
+	  auto &chain = crate.TRMChain[itrm][ichain];
+	  if (!faulty(chain)) continue;
+	  snprintf(line, sizeof(line), "     chain %d: expected %u | detected %u | event counter %u | status %u | bunch ID %u",
+		   ichain, chain.ExpectedData, chain.DetectedData, chain.EventCounterMismatch, chain.BadStatus, chain.BunchIDMismatch);
+	  out << line << std::endl;
+	}
+      }
+    }
+  }
+
+}}}
@@ -0,0 +1,52 @@
+#ifndef _TOF_RAW_DATA_STATISTICS_H
+#define _TOF_RAW_DATA_STATISTICS_H
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "Raw/dataFormat.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** run-level fault counters by crate, TRM and chain, filled by the checks
+      (Checker::count). Each checker and each decoder owns its own, a crate
+      on whole cache lines, they are merged on demand **/
+
+  class Statistics {
+
+  public:
+
+    /** DRMID is 7 bits **/
+    static const int Crates = 128;
+
+    Statistics();
+    Statistics(const Statistics &other) : Statistics() {*this = other;};
+    Statistics &operator=(const Statistics &other);
+
+    CrateCounterData_t &getCrate(uint32_t drmID) {return mCrates[drmID % Crates];};
+    const CrateCounterData_t &getCrate(uint32_t drmID) const {return mCrates[drmID % Crates];};
+    void merge(const Statistics &other);
+    /** same counters in every crate **/
+    bool operator==(const Statistics &other) const;
+    void reset();
+
+    /** binary dump, the crates that have seen events **/
+    bool write(std::string name) const;
+    bool read(std::string name);
+    /** text dump, a line per crate and per TRM and chain with faults **/
+    void print(std::ostream &out) const;
+
+  protected:
+
+    /** the crates on their own cache lines, away from the data of other threads **/
+    std::vector<char> mBuffer;
+    CrateCounterData_t *mCrates;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_STATISTICS_H **/
@@ -0,0 +1,84 @@
+#include "StreamSource.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  StreamSource::StreamSource(long size) :
+    mCapacity(size)
+  {
+    /** must hold the largest packet an RDH can declare **/
+    if (mCapacity < 65536) mCapacity = 65536;
+    mBuffer = new char[mCapacity];
+  }
+  
+  bool
+  StreamSource::open(std::string name)
+  {
+    if (mFD >= 0) {
+      std::cout << "Warning: a stream was already open, closing" << std::endl;
+      close();
+    }
+    mFD = openStream(name);
+    if (mFD < 0) return true;
+    mBegin = mEnd = 0;
+    mEOF = false;
+    mError = 0;
+    return false;
+  }
+
+  bool
+  StreamSource::close()
+  {
+    if (mFD < 0) return true;
+    if (mFD != STDIN_FILENO) ::close(mFD);
+    mFD = -1;
+    return false;
+  }
+
+  char *
+  StreamSource::peek(long size)
+  {
+    if (size > mCapacity) {
+      std::cout << "Warning: peek request exceeds stream buffer" << std::endl;
+      return nullptr;
+    }
+    
+    /** move pending bytes to front if the request does not fit **/
+    if (mBegin + size > mCapacity) {
+      std::memmove(mBuffer, mBuffer + mBegin, mEnd - mBegin);
+      mEnd -= mBegin;
+      mBegin = 0;
+    }
+
+    /** block until enough bytes arrived or the writer is gone **/
+    while (mEnd - mBegin < size && !mEOF) {
+      long nbytes = ::read(mFD, mBuffer + mEnd, mCapacity - mEnd);
+      if (nbytes < 0 && errno == EINTR) continue;
+      if (nbytes < 0) {
+	mError = errno;
+	std::cerr << "Cannot read input: " << std::strerror(mError) << std::endl;
+      }
+      if (nbytes <= 0) mEOF = true;
+      else mEnd += nbytes;
+    }
+    
+    if (mEnd - mBegin < size)
+      return nullptr;
+    return mBuffer + mBegin;
+  }
+
+  bool
+  StreamSource::consume(long size)
+  {
+    if (size > mEnd - mBegin) return true;
+    mBegin += size;
+    if (mBegin == mEnd) mBegin = mEnd = 0;
+    return false;
+  }
+
+}}}
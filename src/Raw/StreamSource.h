@@ -0,0 +1,43 @@
+#ifndef _TOF_RAW_DATA_STREAMSOURCE_H
+#define _TOF_RAW_DATA_STREAMSOURCE_H
+
+#include <string>
+#include <cstdint>
+#include "Raw/Source.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** streaming page source on stdin, fifo or local socket,
+      the buffer never grows so a slow consumer stalls the writer **/
+
+  class StreamSource : public Source {
+
+  public:
+
+    StreamSource(long size = 65536);
+    ~StreamSource() { close(); delete [] mBuffer; };
+
+    bool open(std::string name);
+    bool close();
+    bool isOpen() const {return mFD >= 0;};
+    bool isBad() const {return mError != 0;};
+    char *peek(long size);
+    bool consume(long size);
+
+  protected:
+
+    int mFD = -1;
+    char *mBuffer = nullptr;
+    long mCapacity;
+    long mBegin = 0;
+    long mEnd = 0;
+    bool mEOF = false;
+    int mError = 0;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_STREAMSOURCE_H **/
@@ -0,0 +1,132 @@
+#include "SummaryVisitor.h"
+#include "Checker.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  void
+  SummaryVisitor::clear()
+  {
+    mSummary.DRMCommonHeader  = 0x0;
+    mSummary.DRMOrbitHeader   = 0x0;
+    mSummary.DRMGlobalHeader  = 0x0;
+    mSummary.DRMStatusHeader1 = 0x0;
+    mSummary.DRMStatusHeader2 = 0x0;
+    mSummary.DRMStatusHeader3 = 0x0;
+    mSummary.DRMStatusHeader4 = 0x0;
+    mSummary.DRMStatusHeader5 = 0x0;
+    mSummary.DRMGlobalTrailer = 0x0;
+    mSummary.faultFlags = 0x0;
+    mSummary.decodeError = false;
+    mSummary.checkError = false;
+    mSummary.DRMEventWords = 0;
+    /** only the TRMs written during the last event need a reset **/
+    for (; mTRMDirty; mTRMDirty &= mTRMDirty - 1) {
+      int itrm = __builtin_ctz(mTRMDirty);
+      mSummary.TRMGlobalHeader[itrm]  = 0x0;
+      mSummary.TRMGlobalTrailer[itrm] = 0x0;
+      mSummary.TRMempty[itrm] = true;
+      mSummary.TRMEventWords[itrm] = 0;
+      for (int ichain = 0; ichain < 2; ichain++) {
+	mSummary.TRMChainHeader[itrm][ichain]  = 0x0;
+	mSummary.TRMChainTrailer[itrm][ichain] = 0x0;
+      }
+      std::memset(mSummary.nTDCUnpackedHits[itrm], 0, sizeof(mSummary.nTDCUnpackedHits[itrm]));
+    }
+    mSummary.TDCUnpackedHit.clear();
+    mChainSeen = 0x0;
+    mTRMHeaderSeen = mTRMTrailerSeen = mTRMMismatch = mTRMIntegrityBad = 0x0;
+    mDRMIntegrityBad = false;
+    mChainHeaderSeen = mChainTrailerSeen = mChainMismatch = mChainStatusBad = mChainBunchBad = 0x0;
+  }
+
+  void
+  SummaryVisitor::check(uint32_t trailer)
+  {
+    /** same outcome as Checker::check, TRM by TRM then chain by chain **/
+    uint32_t LocalEventCounter = GET_DRM_LOCALEVENTCOUNTER(trailer);
+
+    /** the counters were compared with the first one seen, if that one is off compare each **/
+    uint32_t trmMismatch = mTRMMismatch;
+    if (mTRMHeaderSeen && mEventNumber != LocalEventCounter % 1024) {
+      trmMismatch = 0x0;
+      for (auto seen = mTRMHeaderSeen; seen; seen &= seen - 1) {
+	int itrm = __builtin_ctz(seen);
+	if (mTRMEventNumber[itrm] != LocalEventCounter % 1024) trmMismatch |= 1 << itrm;
+      }
+    }
+    uint32_t chainMismatch = mChainMismatch;
+    if (mChainTrailerSeen && mEventCounter != LocalEventCounter) {
+      chainMismatch = 0x0;
+      for (auto seen = mChainTrailerSeen; seen; seen &= seen - 1) {
+	int jchain = __builtin_ctz(seen);
+	if (mChainEventCounter[jchain] != LocalEventCounter) chainMismatch |= 1 << jchain;
+      }
+    }
+
+    Checker::Masks_t masks;
+    masks.Selected          = mSlotMask >> 1 & 0x3ff;
+    masks.Participating     = mParticipating >> 1 & 0x3ff;
+    masks.TRMHeader         = mTRMHeaderSeen;
+    masks.TRMTrailer        = mTRMTrailerSeen;
+    masks.TRMEventCounter   = trmMismatch;
+    masks.TRMIntegrity      = mTRMIntegrityBad;
+    masks.ChainHeader       = mChainHeaderSeen;
+    masks.ChainTrailer      = mChainTrailerSeen;
+    masks.ChainEventCounter = chainMismatch;
+    masks.ChainStatus       = mChainStatusBad;
+    masks.ChainBunchID      = mChainBunchBad;
+    mSummary.checkError = Checker::compose(masks, mSummary.faultFlags);
+
+    /** DRM EventWords off, the TRMs are still checked **/
+    if (mDRMIntegrityBad) {
+      mSummary.faultFlags |= 1;
+      mSummary.checkError = true;
+    }
+    if (mFillStatistics) Checker::count(masks, mDRMIntegrityBad, mStatistics.getCrate(GET_DRM_DRMID(mSummary.DRMGlobalHeader)));
+  }
+
+  void
+  SummaryVisitor::closeChain(int itrm, int ichain)
+  {
+    /** move the staged chain hits into place grouped by TDC, stable counting sort **/
+    auto &hits = mSummary.TDCUnpackedHit;
+    auto offset = mSummary.TDCUnpackedHitOffset[itrm][ichain];
+    auto nhits = mSummary.nTDCUnpackedHits[itrm][ichain];
+    auto count = mCount;
+    uint32_t begin = hits.size();
+
+    /** a chain appearing twice in the event keeps its earlier hits first **/
+    auto &previous = mPrevious;
+    previous.clear();
+    uint32_t chainBit = 1 << (itrm * 2 + ichain);
+    if (mChainSeen & chainBit) {
+      for (int itdc = 0; itdc < 15; ++itdc) {
+	for (uint32_t ihit = 0; ihit < nhits[itdc]; ++ihit)
+	  previous.push_back(hits[offset[itdc] + ihit]);
+	count[itdc] += nhits[itdc];
+      }
+    }
+    mChainSeen |= chainBit;
+
+    /** TDCID 15 does not exist, such hits are dropped **/
+    uint32_t position[16];
+    uint32_t sum = begin;
+    for (int itdc = 0; itdc < 15; ++itdc) {
+      offset[itdc] = position[itdc] = sum;
+      nhits[itdc] = count[itdc];
+      sum += count[itdc];
+    }
+    position[15] = sum;
+    hits.resize(sum + count[15]);
+    auto data = hits.data();
+    for (auto hit : previous)
+      data[position[GET_TDCHIT_TDCID(hit)]++] = hit;
+    for (auto hit : mStaged)
+      data[position[GET_TDCHIT_TDCID(hit)]++] = hit;
+    hits.resize(sum);
+    if (!mStaged.empty()) mSummary.TRMempty[itrm] = false;
+  }
+
+}}}
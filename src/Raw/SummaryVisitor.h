@@ -0,0 +1,162 @@
+#ifndef _TOF_RAW_DATA_SUMMARYVISITOR_H
+#define _TOF_RAW_DATA_SUMMARYVISITOR_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Raw/dataFormat.h"
+#include "Raw/Visitor.h"
+#include "Raw/Statistics.h"
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** visitor materialising the full event Summary_t, optionally running the
+      Checker consistency checks on the words as they are decoded **/
+  
+  class SummaryVisitor : public Visitor {
+
+  public:
+
+    SummaryVisitor() {};
+    ~SummaryVisitor() {};
+
+    Summary_t &getSummary() {return mSummary;};
+    /** fill faultFlags and checkError as Checker::check would **/
+    void setCheck(bool val) {mCheck = val;};
+    void setSlotMask(uint32_t val) {mSlotMask = val;};
+    /** integrity counts are coming, see Decoder::setIntegrity **/
+    void setIntegrity(bool val) {mIntegrity = val;};
+    /** run counters of the checks, see Checker::setStatistics **/
+    void setStatistics(bool val) {mFillStatistics = val;};
+    Statistics &getStatistics() {return mStatistics;};
+
+    void onEventBegin() {clear();};
+    void onEventEnd() {
+      if (!mCheck) return;
+      if (mSummary.DRMGlobalTrailer) check(mSummary.DRMGlobalTrailer);
+      /** no DRM trailer, the TRMs are not checked **/
+      else {
+	mSummary.faultFlags |= 1;
+	mSummary.checkError = true;
+	if (mFillStatistics) mStatistics.getCrate(GET_DRM_DRMID(mSummary.DRMGlobalHeader)).DRM.ExpectedData++;
+      }
+    };
+    void onDRMHeader(const uint32_t *words) {
+      mSummary.DRMCommonHeader  = words[0];
+      mSummary.DRMOrbitHeader   = words[1];
+      mSummary.DRMGlobalHeader  = words[2];
+      mSummary.DRMStatusHeader1 = words[3];
+      mSummary.DRMStatusHeader2 = words[4];
+      mSummary.DRMStatusHeader3 = words[5];
+      mSummary.DRMStatusHeader4 = words[6];
+      mSummary.DRMStatusHeader5 = words[7];
+      if (mCheck) {
+	mParticipating = GET_DRM_PARTICIPATINGSLOTID(words[3]);
+	mL0BCID = GET_DRM_L0BCID(words[5]);
+      }
+    };
+    void onDRMTrailer(uint32_t word) {mSummary.DRMGlobalTrailer = word;};
+    void onTRMHeader(int itrm, uint32_t word) {
+      mTRMDirty |= 1 << itrm;
+      mSummary.TRMGlobalHeader[itrm] = word;
+      if (mCheck) {
+	/** event numbers are compared with the first one, the DRM counter comes last **/
+	uint32_t EventNumber = GET_TRM_EVENTNUMBER(word);
+	if (!mTRMHeaderSeen) mEventNumber = EventNumber;
+	mTRMEventNumber[itrm] = EventNumber;
+	mTRMHeaderSeen |= 1 << itrm;
+	setBit(mTRMMismatch, itrm, EventNumber != mEventNumber);
+	/** a header showing up again is compared with the counts of the block already closed **/
+	if (mIntegrity) setIntegrityBit(itrm);
+      }
+    };
+    void onTRMTrailer(int itrm, uint32_t word) {
+      mSummary.TRMGlobalTrailer[itrm] = word;
+      if (mCheck) mTRMTrailerSeen |= 1 << itrm;
+    };
+    void onDRMIntegrity(uint32_t words) {
+      mSummary.DRMEventWords = words;
+      if (mCheck) mDRMIntegrityBad = words != GET_DRM_EVENTWORDS(mSummary.DRMGlobalHeader);
+    };
+    void onTRMIntegrity(int itrm, uint32_t words) {
+      mSummary.TRMEventWords[itrm] = words;
+      if (mCheck) setIntegrityBit(itrm);
+    };
+    void onChainHeader(int itrm, int ichain, uint32_t word) {
+      mSummary.TRMChainHeader[itrm][ichain] = word;
+      mStaged.clear();
+      std::memset(mCount, 0, sizeof(mCount));
+      if (mCheck) {
+	int jchain = 2 * itrm + ichain;
+	mChainHeaderSeen |= 1 << jchain;
+	setBit(mChainBunchBad, jchain, GET_TRMCHAIN_BUNCHID(word) != mL0BCID);
+      }
+    };
+    void onChainTrailer(int itrm, int ichain, uint32_t word) {
+      mSummary.TRMChainTrailer[itrm][ichain] = word;
+      closeChain(itrm, ichain);
+      if (mCheck) {
+	int jchain = 2 * itrm + ichain;
+	uint32_t EventCounter = GET_TRMCHAIN_EVENTCOUNTER(word);
+	if (!mChainTrailerSeen) mEventCounter = EventCounter;
+	mChainEventCounter[jchain] = EventCounter;
+	mChainTrailerSeen |= 1 << jchain;
+	setBit(mChainMismatch, jchain, EventCounter != mEventCounter);
+	setBit(mChainStatusBad, jchain, GET_TRMCHAIN_STATUS(word) != 0);
+      }
+    };
+    void onChainError(int itrm, int ichain) {closeChain(itrm, ichain);};
+    void onHit(int itrm, int ichain, uint32_t word) {
+      mStaged.push_back(word);
+      mCount[GET_TDCHIT_TDCID(word)]++;
+    };
+    void onDecodeError() {mSummary.decodeError = true;};
+    
+  protected:
+
+    void clear();
+    void closeChain(int itrm, int ichain);
+    /** fault flags of the event, once decoded **/
+    void check(uint32_t trailer);
+    static void setBit(uint32_t &mask, int bit, bool val) {mask = (mask & ~(1u << bit)) | (uint32_t)val << bit;};
+    void setIntegrityBit(int itrm) {
+      setBit(mTRMIntegrityBad, itrm, mSummary.TRMEventWords[itrm] != GET_TRM_EVENTWORDS(mSummary.TRMGlobalHeader[itrm]));
+    };
+
+    Summary_t mSummary;
+    std::vector<uint32_t> mStaged;
+    std::vector<uint32_t> mPrevious; // hits of a chain seen earlier in the event
+    uint32_t mCount[16];
+    uint32_t mChainSeen = 0x0;
+    uint32_t mTRMDirty = 0x3ff; // all TRMs need a reset at the first event
+
+    /** inline check state, masks by TRM (bit itrm) and chain (bit 2 * itrm + ichain) **/
+    bool mCheck = false;
+    bool mIntegrity = false;
+    uint32_t mSlotMask = 0x7ff;
+    uint32_t mParticipating;
+    uint32_t mL0BCID;
+    uint32_t mEventNumber;
+    uint32_t mEventCounter;
+    uint32_t mTRMEventNumber[10];
+    uint32_t mChainEventCounter[20];
+    uint32_t mTRMHeaderSeen = 0x0;
+    uint32_t mTRMTrailerSeen = 0x0;
+    uint32_t mTRMMismatch = 0x0;
+    uint32_t mTRMIntegrityBad = 0x0;
+    bool mDRMIntegrityBad = false;
+    uint32_t mChainHeaderSeen = 0x0;
+    uint32_t mChainTrailerSeen = 0x0;
+    uint32_t mChainMismatch = 0x0;
+    uint32_t mChainStatusBad = 0x0;
+    uint32_t mChainBunchBad = 0x0;
+    bool mFillStatistics = false;
+    Statistics mStatistics;
+    
+  };
+  
+}}}
+
+#endif /** _TOF_RAW_DATA_SUMMARYVISITOR_H **/
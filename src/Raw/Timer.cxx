@@ -0,0 +1,107 @@
+#include "Timer.h"
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  uint32_t Timer::mDefaultSampling = 1;
+
+  double
+  Timer::seconds(uint64_t ticks)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    /** calibrate the counter against the steady clock, once **/
+    static const double period = [] {
+      auto t0 = std::chrono::steady_clock::now();
+      auto c0 = __rdtsc();
+      while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(20));
+      auto c1 = __rdtsc();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+      return elapsed.count() / (c1 - c0);
+    }();
+    return ticks * period;
+#else
+    return 1.e-9 * ticks;
+#endif
+  }
+
+  int
+  Timer::bin(uint64_t ticks)
+  {
+    if (ticks < 8) return ticks;
+    int octave = 63 - __builtin_clzll(ticks);
+    return (octave - 2) * 8 + ((ticks >> (octave - 3)) & 7);
+  }
+
+  uint64_t
+  Timer::edge(int bin)
+  {
+    if (bin < 8) return bin;
+    int octave = bin / 8 + 2;
+    return (uint64_t)(8 + bin % 8) << (octave - 3);
+  }
+
+  void
+  Timer::fill(uint64_t ticks)
+  {
+    mSamples++;
+    mTicks += ticks;
+    if (ticks > mMax) mMax = ticks;
+    mHisto[bin(ticks)]++;
+  }
+
+  void
+  Timer::merge(const Timer &other)
+  {
+    mCalls += other.mCalls;
+    mSamples += other.mSamples;
+    mTicks += other.mTicks;
+    if (other.mMax > mMax) mMax = other.mMax;
+    for (int i = 0; i < mBins; ++i)
+      mHisto[i] += other.mHisto[i];
+  }
+
+  void
+  Timer::reset()
+  {
+    mCalls = mSamples = mTicks = mMax = 0;
+    for (int i = 0; i < mBins; ++i)
+      mHisto[i] = 0;
+  }
+
+  double
+  Timer::getTime() const
+  {
+    if (!mSamples) return 0.;
+    return seconds(mTicks) * mCalls / mSamples;
+  }
+
+  double
+  Timer::getQuantile(double q) const
+  {
+    if (!mSamples) return 0.;
+    uint64_t target = q * mSamples, sum = 0;
+    for (int i = 0; i < mBins; ++i) {
+      sum += mHisto[i];
+      /** middle of the bin **/
+      if (sum > target) return seconds((edge(i) + edge(i + 1)) / 2);
+    }
+    return getMax();
+  }
+
+  std::string
+  Timer::summary() const
+  {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+	<< "p50 " << 1.e6 * getQuantile(0.50) << " us"
+	<< " | p99 " << 1.e6 * getQuantile(0.99) << " us"
+	<< " | max " << 1.e6 * getMax() << " us"
+	<< " | " << mSamples << "/" << mCalls << " sampled";
+    return out.str();
+  }
+
+}}}
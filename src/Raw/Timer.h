@@ -0,0 +1,107 @@
+#ifndef _TOF_RAW_DATA_TIMER_H
+#define _TOF_RAW_DATA_TIMER_H
+
+#include <string>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** low-overhead stage timer on the time-stamp counter, sampled every
+      N calls, keeps the total and a latency histogram. Compiled out with
+      TIMERS_DISABLED **/
+
+  class Timer {
+
+  public:
+
+    Timer() : mSampling(mDefaultSampling) {};
+
+    /** ticks at the start of a sampled call, 0 if not sampled **/
+    uint64_t start() {
+#ifdef TIMERS_DISABLED
+      return 0;
+#else
+      if (++mCalls % mSampling) return 0;
+      return ticks();
+#endif
+    };
+    /** close a call opened by start, elapsed ticks **/
+    uint64_t stop(uint64_t start) {
+#ifdef TIMERS_DISABLED
+      return 0;
+#else
+      if (!start) return 0;
+      uint64_t elapsed = ticks() - start;
+      fill(elapsed);
+      return elapsed;
+#endif
+    };
+
+    void setSampling(uint32_t val) {mSampling = val > 0 ? val : 1;};
+    static void setDefaultSampling(uint32_t val) {mDefaultSampling = val > 0 ? val : 1;};
+    void merge(const Timer &other);
+    void reset();
+
+    uint64_t getCalls() const {return mCalls;};
+    uint64_t getSamples() const {return mSamples;};
+    /** total time, extrapolated from the samples to all calls **/
+    double getTime() const;
+    /** latency of one call at quantile q, from the histogram **/
+    double getQuantile(double q) const;
+    double getMax() const {return seconds(mMax);};
+    /** p50 / p99 / max latency line **/
+    std::string summary() const;
+
+    static double seconds(uint64_t ticks);
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    };
+
+  protected:
+
+    /** log-linear bins, 8 per octave **/
+    static const int mBins = 512;
+    static int bin(uint64_t ticks);
+    static uint64_t edge(int bin);
+    void fill(uint64_t ticks);
+
+    static uint32_t mDefaultSampling;
+    uint32_t mSampling;
+    uint64_t mCalls = 0;
+    uint64_t mSamples = 0;
+    uint64_t mTicks = 0;
+    uint64_t mMax = 0;
+    uint32_t mHisto[mBins] = {0};
+
+  };
+
+  /** times the enclosing scope **/
+
+  class ScopedTimer {
+
+  public:
+
+    ScopedTimer(Timer &timer) : mTimer(timer), mStart(timer.start()) {};
+    ~ScopedTimer() { mTimer.stop(mStart); };
+
+  protected:
+
+    Timer &mTimer;
+    uint64_t mStart;
+
+  };
+
+}}}
+
+#endif /** _TOF_RAW_DATA_TIMER_H **/
@@ -0,0 +1,41 @@
+#ifndef _TOF_RAW_DATA_VISITOR_H
+#define _TOF_RAW_DATA_VISITOR_H
+
+#include <cstdint>
+
+namespace tof {
+namespace data {
+namespace raw {
+
+  /** decode visitor with no-op handlers
+      Decoder::decode(visitor) resolves the handlers at compile time,
+      consumers derive from it and hide only the handlers they need **/
+  
+  class Visitor {
+
+  public:
+
+    /** event boundaries **/
+    void onEventBegin() {};
+    void onEventEnd() {};
+    /** DRM common, orbit, global and status headers 1-5, 8 consecutive words **/
+    void onDRMHeader(const uint32_t *words) {};
+    void onDRMTrailer(uint32_t word) {};
+    void onTRMHeader(int itrm, uint32_t word) {};
+    void onTRMTrailer(int itrm, uint32_t word) {};
+    /** words from the header to the trailer, after the trailer, with Decoder::setIntegrity **/
+    void onDRMIntegrity(uint32_t words) {};
+    void onTRMIntegrity(int itrm, uint32_t words) {};
+    void onChainHeader(int itrm, int ichain, uint32_t word) {};
+    void onChainTrailer(int itrm, int ichain, uint32_t word) {};
+    /** chain interrupted by an unexpected word, no trailer will follow **/
+    void onChainError(int itrm, int ichain) {};
+    void onHit(int itrm, int ichain, uint32_t word) {};
+    /** event truncated at the end of the page **/
+    void onDecodeError() {};
+
+  };
+  
+}}}
+
+#endif /** _TOF_RAW_DATA_VISITOR_H **/
@@ -29,11 +29,14 @@
 #define GET_DRM_SLOTENABLEMASK(x)      ( (x & 0x00007FF0) >>  4 )
 #define GET_DRM_L0BCID(x)              ( (x & 0x0000FFF0) >>  4 )
 #define GET_DRM_LOCALEVENTCOUNTER(x)   ( (x & 0x0000FFF0) >>  4 )
+#define GET_DRM_EVENTWORDS(x)          ( (x & 0x001FFFF0) >>  4 )
 
 #define GET_TRM_SLOTID(x)              ( (x & 0x0000000F) )
 #define GET_TRM_EVENTNUMBER(x)         ( (x & 0x07FE0000) >> 17 )
 #define GET_TRM_EVENTWORDS(x)          ( (x & 0x0001FFF0) >>  4 )
 
+#define GET_LTM_EVENTWORDS(x)          ( (x & 0x0001FFF0) >>  4 )
+
 #define GET_TRMCHAIN_BUNCHID(x)        ( (x & 0x0000FFF0) >>  4 )
 #define GET_TRMCHAIN_EVENTCOUNTER(x)   ( (x & 0x0FFF0000) >> 16 )
 #define GET_TRMCHAIN_STATUS(x)         ( (x & 0x0000000F) )
@@ -113,13 +116,59 @@ namespace raw {
     uint32_t RESERVED3     :  8;
   };
 
+  /** RDH v6, also v5 and v7, same size and sizes/counters in place, the rest moved **/
+
+  struct RDHv6Word0_t {
+    uint32_t HeaderVersion   :  8;
+    uint32_t HeaderSize      :  8;
+    uint32_t FeeID           : 16;
+    uint32_t PriorityBit     :  8;
+    uint32_t SourceID        :  8;
+    uint32_t RESERVED        : 16;
+    uint32_t OffsetNewPacket : 16;
+    uint32_t MemorySize      : 16;
+    uint32_t LinkID          :  8;
+    uint32_t PacketCounter   :  8;
+    uint32_t CruID           : 12;
+    uint32_t EndPointID      :  4;
+  };
+
+  struct RDHv6Word1_t {
+    uint32_t BC              : 12;
+    uint32_t RESERVED1       : 20;
+    uint32_t Orbit           : 32;
+    uint32_t RESERVED2       : 32;
+    uint32_t RESERVED3       : 32;
+  };
+
+  struct RDHv6Word2_t {
+    uint32_t TrgType         : 32;
+    uint32_t PagesCounter    : 16;
+    uint32_t StopBit         :  8;
+    uint32_t RESERVED1       :  8;
+    uint32_t RESERVED2       : 32;
+    uint32_t RESERVED3       : 32;
+  };
+
+  struct RDHv6Word3_t {
+    uint32_t DetectorField   : 32;
+    uint32_t Par             : 16;
+    uint32_t RESERVED1       : 16;
+    uint32_t RESERVED2       : 32;
+    uint32_t RESERVED3       : 32;
+  };
+
   union RDH_t
   {
-    uint32_t    Data[4];
-    RDHWord0_t  Word0;
-    RDHWord1_t  Word1;
-    RDHWord2_t  Word2;
-    RDHWord3_t  Word3;
+    uint32_t      Data[4];
+    RDHWord0_t    Word0;
+    RDHWord1_t    Word1;
+    RDHWord2_t    Word2;
+    RDHWord3_t    Word3;
+    RDHv6Word0_t  V6Word0;
+    RDHv6Word1_t  V6Word1;
+    RDHv6Word2_t  V6Word2;
+    RDHv6Word3_t  V6Word3;
   };
 
   /** DRM data **/
@@ -195,6 +244,18 @@ namespace raw {
     uint32_t WordType          :  4;
   };
   
+  /** LTM data **/
+  
+  struct LTMGlobalHeader_t
+  {
+    uint32_t SlotID     :  4;
+    uint32_t EventWords : 13;
+    uint32_t CycloneErr :  1;
+    uint32_t Fault      :  6;
+    uint32_t UNDEFINED  :  4;
+    uint32_t WordType   :  4;
+  };
+  
   /** TRM data **/
   
   struct TRMGlobalHeader_t
@@ -265,6 +326,7 @@ namespace raw {
 
   struct Summary_t
   {
+    // as read, in the layout of their HeaderVersion (see RDH.h)
     RDHWord0_t         RDHWord0;
     RDHWord1_t         RDHWord1;
     RDHWord2_t         RDHWord2;
@@ -282,13 +344,19 @@ namespace raw {
     uint32_t TRMGlobalTrailer[10];
     uint32_t TRMChainHeader[10][2];
     uint32_t TRMChainTrailer[10][2];
-    uint32_t TDCUnpackedHit[10][2][15][256];
-    uint8_t  nTDCUnpackedHits[10][2][15];
+    // hits grouped by TRM/chain/TDC, TDCUnpackedHitOffset[itrm][ichain][itdc] is the first
+    std::vector<uint32_t> TDCUnpackedHit;
+    uint32_t TDCUnpackedHitOffset[10][2][15];
+    uint32_t nTDCUnpackedHits[10][2][15];
     // derived data
     bool TRMempty[10];
     // status
     bool decodeError;
     uint32_t faultFlags;
+    bool checkError;   // Checker::check result, when checked by the decoder
+    // counted and computed by the decoder, with Decoder::setIntegrity
+    uint32_t DRMEventWords;
+    uint32_t TRMEventWords[10];
   };
 
       
@@ -300,6 +368,7 @@ namespace raw {
     uint32_t DetectedData;
     uint32_t EventCounterMismatch;
     uint32_t BadStatus;
+    uint32_t BunchIDMismatch;
   };
   
   struct TRMCounterData_t
@@ -316,6 +385,31 @@ namespace raw {
     uint32_t DetectedData;
     uint32_t EventWordsMismatch;
   };
+
+  /** run-level counters of a crate (DRMID), TRMs and chains by SlotID - 3 **/
+  
+  struct CrateCounterData_t
+  {
+    uint32_t DRMID;
+    DRMCounterData_t DRM;
+    TRMCounterData_t TRM[10];
+    TRMChainCounterData_t TRMChain[10][2];
+  };
+
+  /** event index data **/
+
+  struct EventIndex_t
+  {
+    uint64_t Offset;     // file offset of the DRM common header
+    uint64_t PageOffset; // file offset of the page RDH
+    uint32_t Page;       // page number in the file, from 1 as Decoder::getPageCounter
+    uint32_t Word;       // DRM common header position in the page payload words
+    uint32_t Length;     // event length in payload words, filler included
+    uint32_t Orbit;      // DRM orbit header
+    uint16_t FeeID;
+    uint16_t L0BCID;
+    uint32_t RESERVED;
+  };
   
 }}}
 
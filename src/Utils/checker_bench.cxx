@@ -0,0 +1,149 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <cstdint>
+#include <random>
+#include <chrono>
+#include <vector>
+#include "Raw/dataFormat.h"
+#include "Raw/Checker.h"
+
+/** synthetic event summaries, all TRMs participating and consistent, a fraction
+    of them with one or more random faults, checked by the scalar and the
+    vectorised Checker **/
+
+static void
+fill(tof::data::raw::Summary_t &summary, uint32_t eventCounter, uint32_t bunchID)
+{
+  summary.DRMCommonHeader  = 0x40000000;
+  summary.DRMOrbitHeader   = 0x0;
+  summary.DRMGlobalHeader  = 0x40000001;
+  summary.DRMStatusHeader1 = 0x7fe << 4 | 0x1;
+  summary.DRMStatusHeader2 = 0x7fe << 4 | 0x1;
+  summary.DRMStatusHeader3 = bunchID << 4 | 0x1;
+  summary.DRMStatusHeader4 = 0x1;
+  summary.DRMStatusHeader5 = 0x1;
+  summary.DRMGlobalTrailer = 0x50000000 | eventCounter << 4 | 0x1;
+  for (int itrm = 0; itrm < 10; ++itrm) {
+    uint32_t SlotID = itrm + 3;
+    summary.TRMGlobalHeader[itrm]  = 0x40000000 | (eventCounter % 1024) << 17 | SlotID;
+    summary.TRMGlobalTrailer[itrm] = 0x50000003;
+    for (int ichain = 0; ichain < 2; ++ichain) {
+      summary.TRMChainHeader[itrm][ichain]  = (uint32_t)(2 * ichain) << 28 | bunchID << 4 | SlotID;
+      summary.TRMChainTrailer[itrm][ichain] = (uint32_t)(2 * ichain + 1) << 28 | eventCounter << 16;
+    }
+  }
+  summary.faultFlags = 0x0;
+}
+
+static void
+spoil(tof::data::raw::Summary_t &summary, std::mt19937 &rng)
+{
+  std::uniform_int_distribution<int> fault(0, 8), trm(0, 9), chain(0, 1), nfaults(1, 3);
+  for (int i = nfaults(rng); i > 0; --i) {
+    int itrm = trm(rng), ichain = chain(rng);
+    switch (fault(rng)) {
+    case 0: summary.DRMStatusHeader1 &= ~(1 << (itrm + 5)); break;
+    case 1: summary.TRMGlobalHeader[itrm] = 0x0; break;
+    case 2: summary.TRMGlobalTrailer[itrm] = 0x0; break;
+    case 3: summary.TRMGlobalHeader[itrm] ^= 1 << 17; break;
+    case 4: summary.TRMChainHeader[itrm][ichain] = 0x0; break;
+    case 5: summary.TRMChainTrailer[itrm][ichain] = 0x0; break;
+    case 6: summary.TRMChainTrailer[itrm][ichain] ^= 1 << 16; break;
+    case 7: summary.TRMChainTrailer[itrm][ichain] |= 0x3; break;
+    case 8: summary.TRMChainHeader[itrm][ichain] ^= 1 << 4; break;
+    }
+  }
+}
+
+/** ns per event over the whole sample, repeated **/
+template <typename F>
+static double
+run(std::vector<tof::data::raw::Summary_t> &summaries, int repeat, F check, long &bad)
+{
+  bad = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int irepeat = 0; irepeat < repeat; ++irepeat)
+    for (auto &summary : summaries) {
+      summary.faultFlags = 0x0;
+      bad += check(summary);
+    }
+  std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+  return 1.e9 * elapsed.count() / repeat / summaries.size();
+}
+
+int main(int argc, char **argv)
+{
+
+  int events = 4096, repeat = 200;
+  double faulty = -1.;
+
+  /** define arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help", "Print help messages")
+    ("events,n", po::value<int>(&events)->default_value(4096), "Synthetic events")
+    ("repeat", po::value<int>(&repeat)->default_value(200), "Passes over the events")
+    ("faulty", po::value<double>(&faulty)->default_value(-1.), "Fraction of faulty events (default: 0 and 0.5)")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+
+  /** process arguments **/
+  try {
+    /** help **/
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 1;
+    }
+    po::notify(vm);
+  }
+  catch(std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  std::vector<double> fractions;
+  if (faulty < 0.) fractions = {0., 0.5};
+  else fractions = {faulty};
+
+  /** the checks themselves, keep the stage timer out of the way **/
+  tof::data::raw::Timer::setDefaultSampling(1000000);
+  tof::data::raw::Checker checker;
+  for (auto fraction : fractions) {
+
+    /** the same events for both paths **/
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+    std::uniform_int_distribution<uint32_t> counter(0, 4095);
+    std::vector<tof::data::raw::Summary_t> summaries(events);
+    for (auto &summary : summaries) {
+      fill(summary, counter(rng), counter(rng));
+      if (uniform(rng) < fraction) spoil(summary, rng);
+    }
+
+    /** the two paths agree **/
+    long mismatches = 0;
+    for (auto &summary : summaries) {
+      summary.faultFlags = 0x0;
+      bool status = checker.checkScalar(summary);
+      uint32_t faultFlags = summary.faultFlags;
+      summary.faultFlags = 0x0;
+      if (checker.check(summary) != status || summary.faultFlags != faultFlags) mismatches++;
+    }
+
+    long badScalar, badVector;
+    double scalar = run(summaries, repeat, [&](tof::data::raw::Summary_t &summary) {return checker.checkScalar(summary);}, badScalar);
+    double vector = run(summaries, repeat, [&](tof::data::raw::Summary_t &summary) {return checker.check(summary);}, badVector);
+    std::cout << " " << 100. * fraction << "% faulty events: " << badScalar / repeat << "/" << events << " bad"
+	      << " | scalar " << scalar << " ns/event"
+	      << " | vector " << vector << " ns/event"
+	      << " | speedup " << scalar / vector
+	      << " | " << mismatches << " mismatches"
+	      << std::endl;
+  }
+
+  return 0;
+}
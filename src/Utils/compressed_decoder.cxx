@@ -3,11 +3,13 @@
 #include <fstream>
 #include <cstdint>
 #include "Compressed/Decoder.h"
+#include "Raw/Counters.h"
 
 int main(int argc, char **argv)
 {
 
   bool verbose = false;
+  int counters = 0;
   std::string inFileName;
   
   /** define arguments **/
@@ -17,6 +19,7 @@ int main(int argc, char **argv)
     ("help", "Print help messages")
     ("verbose,v", po::bool_switch(&verbose), "Decode verbose")
     ("input,i", po::value<std::string>(&inFileName), "Input data file")
+    ("counters", po::value<int>(&counters)->default_value(0), "Read hardware counters every N events (0 = off)")
     //    ("word,w",  po::value<int>(&wordn)->default_value(2), "Word where to find the data")
     ;
 
@@ -43,6 +46,7 @@ int main(int argc, char **argv)
       return 1;
   }
   
+  tof::data::raw::Counters::setDefaultSampling(counters);
   tof::data::compressed::Decoder decoder;
   decoder.setVerbose(verbose);
   decoder.load(inFileName);
@@ -52,9 +56,11 @@ int main(int argc, char **argv)
   
   decoder.close();
   
-  std::cout << " benchmark: decoded " << decoder.mIntegratedBytes << " bytes in " << decoder.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mIntegratedTime << " MB/s"
+  std::cout << " benchmark: decoded " << decoder.mIntegratedBytes << " bytes in " << decoder.mTimer.getTime() << " s"
+	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mTimer.getTime() << " MB/s"
 	    << std::endl;
+  std::cout << " latency: " << decoder.mTimer.summary() << std::endl;
+  if (counters) std::cout << " counters: " << decoder.mCounters.summary() << std::endl;
   
 
   
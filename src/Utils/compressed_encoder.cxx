@@ -2,16 +2,22 @@
 #include <iostream>
 #include <fstream>
 #include <cstdint>
-#include <chrono>
 #include "Raw/Decoder.h"
+#include "Raw/Demux.h"
+#include "Raw/ParallelDecoder.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
 #include "Raw/Checker.h"
 #include "Compressed/Encoder.h"
 
 int main(int argc, char **argv)
 {
 
-  bool verbose = false, rewind = false;
-  std::string inFileName, outFileName;
+  bool verbose = false, mmap = false, rewind = false, demux = false, fused = false, integrity = false;
+  int depth = 0, threads = 0;
+  long unit = 1048576, lookahead = 0;
+  int sample = 1, counters = 0;
+  std::string inFileName, outFileName, statisticsFileName, slots = "0x7ff", chains = "0xfffff";
   
   /** define arguments **/
   namespace po = boost::program_options;
@@ -20,7 +26,20 @@ int main(int argc, char **argv)
     ("help", "Print help messages")
     ("verbose,v", po::bool_switch(&verbose), "Decode verbose")
     ("rewind,r", po::bool_switch(&rewind), "Rewind on failed check")
-    ("input,i", po::value<std::string>(&inFileName), "Input data file")
+    ("fused", po::bool_switch(&fused), "Check while decoding instead of in a second pass")
+    ("integrity", po::bool_switch(&integrity), "Check DRM/TRM EventWords")
+    ("statistics", po::value<std::string>(&statisticsFileName), "Count the faults by crate, slot and chain, print them and write them to this file")
+    ("input,i", po::value<std::string>(&inFileName), "Input data file, - for stdin, unix:<path> for socket")
+    ("mmap", po::bool_switch(&mmap), "Memory-mapped input")
+    ("async", po::value<int>(&depth)->default_value(0), "Read-ahead depth (0 = synchronous)")
+    ("demux", po::bool_switch(&demux), "Route pages to per-link decoders by FeeID/CruID")
+    ("lookahead", po::value<long>(&lookahead)->default_value(0), "Pages a link with an open event is waited for by --demux, an event cut by it is an error (0 = until the end of the input)")
+    ("threads,j", po::value<int>(&threads)->default_value(0), "Decoding threads (0 = single-threaded)")
+    ("unit", po::value<long>(&unit)->default_value(1048576), "Bytes per parallel work unit")
+    ("sample", po::value<int>(&sample)->default_value(1), "Time one event every N")
+    ("counters", po::value<int>(&counters)->default_value(0), "Read hardware counters every N events (0 = off)")
+    ("slots", po::value<std::string>(&slots), "Decode only these slots (mask, bit SlotID - 2, LTM is bit 0)")
+    ("chains", po::value<std::string>(&chains), "Decode hits of these TRM chains only (mask, bit 2 * (SlotID - 3) + chain)")
     ("output,o", po::value<std::string>(&outFileName), "Output data file")
     //    ("word,w",  po::value<int>(&wordn)->default_value(2), "Word where to find the data")
     ;
@@ -48,72 +67,214 @@ int main(int argc, char **argv)
     return 1;
   }
   
-  tof::data::raw::Decoder decoder;
-  decoder.setVerbose(verbose);
-  decoder.init();
-  if (decoder.open(inFileName)) return 1;
+  uint32_t slotMask = std::stoul(slots, nullptr, 0), chainMask = std::stoul(chains, nullptr, 0);
+  tof::data::raw::Timer::setDefaultSampling(sample);
+  tof::data::raw::Counters::setDefaultSampling(counters);
+  auto source = mmap ? tof::data::raw::Source_Mapped : depth > 0 ? tof::data::raw::Source_Async : tof::data::raw::Source_File;
+  bool statistics = !statisticsFileName.empty();
+  auto report = [&](const tof::data::raw::Statistics &counts) {
+    std::cout << " run statistics: " << statisticsFileName << std::endl;
+    counts.print(std::cout);
+    return counts.write(statisticsFileName);
+  };
+
+  /** page-parallel decoding, outputs are written in input order **/
+  if (threads > 0) {
+    if (rewind) std::cout << "Warning: rewind is not available with threads" << std::endl;
+    tof::data::raw::ParallelDecoder engine;
+    engine.setVerbose(verbose);
+    engine.setSource(source);
+    engine.setDepth(depth);
+    engine.setThreads(threads);
+    engine.setUnitSize(unit);
+    engine.setSlotMask(slotMask);
+    engine.setChainMask(chainMask);
+    engine.setCheck(fused);
+    engine.setIntegrity(integrity);
+    engine.setStatistics(statistics && fused);
+    engine.init();
+    if (engine.open(inFileName)) return 1;
+    std::ofstream file(outFileName.c_str(), std::fstream::out | std::fstream::binary);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open " << outFileName << std::endl;
+      return 1;
+    }
+
+    /** one checker and encoder per worker **/
+    std::vector<tof::data::raw::Checker> checkers(threads);
+    std::vector<tof::data::compressed::Encoder> encoders(threads);
+    for (int i = 0; i < threads; ++i) {
+      checkers[i].setVerbose(verbose);
+      checkers[i].setSlotMask(slotMask);
+      checkers[i].setIntegrity(integrity);
+      checkers[i].setStatistics(statistics && !fused);
+      encoders[i].setVerbose(verbose);
+      encoders[i].init();
+    }
+    auto process = [&](int worker, tof::data::raw::Decoder &decoder, std::vector<char> &output) {
+      decoder.decodeRDH();
+      while (!decoder.decode()) {
+	if (!fused) checkers[worker].check(decoder.getSummary());
+	encoders[worker].encode(decoder.getSummary());
+      }
+      encoders[worker].flush(output);
+    };
+    auto sink = [&](const char *output, long size) {
+      file.write(output, size);
+    };
+
+    tof::data::raw::Timer wall;
+    wall.setSampling(1);
+    auto start = wall.start();
+    engine.run(process, sink);
+    wall.stop(start);
+    file.close();
+
+    double decoderBytes = engine.getIntegratedBytes(), encoderBytes = 0.;
+    auto decoderTimer = engine.getTimer();
+    tof::data::raw::Timer checkerTimer, encoderTimer;
+    auto decoderCounters = engine.getCounters();
+    auto skipped = engine.getSkippedBytes();
+    auto counts = engine.getStatistics();
+    tof::data::raw::Counters checkerCounters, encoderCounters;
+    for (int i = 0; i < threads; ++i) {
+      if (!fused) counts.merge(checkers[i].getStatistics());
+      checkerTimer.merge(checkers[i].mTimer);
+      encoderTimer.merge(encoders[i].mTimer);
+      checkerCounters.merge(checkers[i].mCounters);
+      encoderCounters.merge(encoders[i].mCounters);
+      encoderBytes += encoders[i].mIntegratedBytes;
+    }
+    double decoderTime = decoderTimer.getTime(), checkerTime = checkerTimer.getTime(), encoderTime = encoderTimer.getTime();
+    auto &scheduler = engine.getScheduler();
+    for (int i = 0; i < scheduler.getNWorkers(); ++i)
+      std::cout << " worker " << i << ": " << scheduler.getExecuted(i) << " units, " << scheduler.getStolen(i) << " stolen"
+		<< " | " << 100. * scheduler.getBusyTime(i) / wall.getTime() << "% busy"
+		<< std::endl;
+    bool bad = engine.isBad();
+    engine.close();
+
+    std::cout << " decoder benchmark: " << decoderBytes << " bytes in " << decoderTime << " s (all threads)"
+	      << " | " << 1.e-6 * decoderBytes / decoderTime << " MB/s"
+	      << std::endl;
+    std::cout << " decoder latency: " << decoderTimer.summary() << std::endl;
+    if (counters) std::cout << " decoder counters: " << decoderCounters.summary() << std::endl;
+    if (fused)
+      std::cout << " checker benchmark: fused in the decoder" << std::endl;
+    else {
+      std::cout << " checker benchmark: " << decoderBytes << " bytes in " << checkerTime << " s (all threads)"
+		<< " | " << 1.e-6 * decoderBytes / checkerTime << " MB/s"
+		<< std::endl;
+      std::cout << " checker latency: " << checkerTimer.summary() << std::endl;
+      if (counters) std::cout << " checker counters: " << checkerCounters.summary() << std::endl;
+    }
+    std::cout << " encoder benchmark: " << encoderBytes << " bytes in " << encoderTime << " s (all threads)"
+	      << " | " << 1.e-6 * encoderBytes / encoderTime << " MB/s"
+	      << std::endl;
+    std::cout << " encoder latency: " << encoderTimer.summary() << std::endl;
+    if (counters) std::cout << " encoder counters: " << encoderCounters.summary() << std::endl;
+    std::cout << " parallel benchmark: " << decoderBytes << " bytes in " << wall.getTime() << " s with " << threads << " threads"
+	      << " | " << 1.e-6 * decoderBytes / wall.getTime() << " MB/s"
+	      << std::endl;
+    if (skipped)
+      std::cout << " resync: skipped " << skipped << " bytes of corrupted data" << std::endl;
+    if (statistics && report(counts)) return 1;
+    if (bad) return 1;
+    return 0;
+  }
+
+  tof::data::raw::Decoder single;
+  tof::data::raw::Demux mux;
+  if (demux) {
+    mux.setVerbose(verbose);
+    mux.setSource(source);
+    mux.setDepth(depth);
+    mux.setSlotMask(slotMask);
+    mux.setChainMask(chainMask);
+    mux.setCheck(fused);
+    mux.setIntegrity(integrity);
+    mux.setStatistics(statistics && fused);
+    mux.setLookahead(lookahead);
+    mux.init();
+    if (mux.open(inFileName)) return 1;
+  }
+  else {
+    single.setVerbose(verbose);
+    single.setSource(source);
+    single.setDepth(depth);
+    single.setSlotMask(slotMask);
+    single.setChainMask(chainMask);
+    single.setCheck(fused);
+    single.setIntegrity(integrity);
+    single.setStatistics(statistics && fused);
+    single.init();
+    if (single.open(inFileName)) return 1;
+  }
+  /** next page, from the only link or from the link that owns it **/
+  auto next = [&]() -> tof::data::raw::Decoder * {
+    if (demux) return mux.next();
+    return single.read() ? nullptr : &single;
+  };
 
   tof::data::raw::Checker checker;
   checker.setVerbose(verbose);
+  checker.setSlotMask(slotMask);
+  checker.setIntegrity(integrity);
+  checker.setStatistics(statistics && !fused);
   
   tof::data::compressed::Encoder encoder;
   encoder.setVerbose(verbose);
   encoder.init();
   if (encoder.open(outFileName)) return 1;
 
-  /** chrono **/
-  std::chrono::time_point<std::chrono::high_resolution_clock> start, finish;
-  std::chrono::duration<double> elapsed;
-  double integratedTime;
+  /** page timer **/
+  tof::data::raw::Timer local;
+  local.setSampling(1);
  
   /** loop over pages **/
-  while (!decoder.read()) {
+  while (auto decoder = next()) {
 
-    /** get start chrono **/
-    start = std::chrono::high_resolution_clock::now();	
+    /** start page timer **/
+    auto start = local.start();
     
-    /** decode RDH open **/
-    decoder.decodeRDH();
+    /** decode RDH **/
+    decoder->decodeRDH();
     
     /** decode loop **/
-    while (!decoder.decode()) {
+    long counted = 0;
+    while (!decoder->decode()) {
+      counted++;
       
-      /** check: if error rewind, print and pause **/
-      if (checker.check(decoder.getSummary()) && rewind) {
-	decoder.rewind();
-	decoder.setVerbose(true);
+      /** check **/
+      bool error = fused ? decoder->getSummary().checkError : checker.check(decoder->getSummary());
+
+      /** encode **/
+      encoder.encode(decoder->getSummary());
+
+      /** if error rewind, print and pause **/
+      if (error && rewind) {
+	/** the events up to this one are already counted and encoded, the ones after it are done here **/
+	decoder->rewind();
+	decoder->setVerbose(true);
 	checker.setVerbose(true);
-	decoder.decodeRDH();
-	while (!decoder.decode())
-	  if (checker.check(decoder.getSummary()))
+	for (long ievent = 0; ; ++ievent) {
+	  decoder->setStatistics(statistics && fused && ievent >= counted);
+	  checker.setStatistics(statistics && !fused && ievent >= counted);
+	  if (decoder->decode()) break;
+	  if (checker.check(decoder->getSummary()))
 	    getchar();
-	decoder.setVerbose(verbose);
+	  if (ievent >= counted) encoder.encode(decoder->getSummary());
+	}
+	decoder->setVerbose(verbose);
+	decoder->setStatistics(statistics && fused);
 	checker.setVerbose(verbose);
+	checker.setStatistics(statistics && !fused);
       }
-      
-      /** encode **/
-      encoder.encode(decoder.getSummary());
 
     } /** end of decode loop **/
 
-    /** pause chrono for IO operation **/
-    finish = std::chrono::high_resolution_clock::now();
-    elapsed = finish - start;
-    integratedTime += elapsed.count();
-    
-    /** read page **/
-    decoder.read();
-
-    /** restart chrono after IO operation **/
-    start = std::chrono::high_resolution_clock::now();
-    
-    /** decode RDH close **/
-    decoder.decodeRDH();
-    
-    /** get finish chrono and increment **/
-    finish = std::chrono::high_resolution_clock::now();
-    elapsed = finish - start;
-    integratedTime += elapsed.count();
+    /** stop page timer **/
+    local.stop(start);
     
     /** flush encoder **/
     encoder.flush();
@@ -121,21 +282,49 @@ int main(int argc, char **argv)
   } /** end of loop over pages **/
   
   encoder.close();
-  decoder.close();
+  double decoderBytes = demux ? mux.getIntegratedBytes() : single.mIntegratedBytes;
+  auto decoderTimer = demux ? mux.getTimer() : single.mTimer;
+  auto decoderCounters = demux ? mux.getCounters() : single.mCounters;
+  auto counts = !fused ? checker.getStatistics() : demux ? mux.getStatistics() : single.getStatistics();
+  double decoderTime = decoderTimer.getTime();
+  auto cut = demux ? mux.getCutEvents() : 0;
+  if (demux) mux.close();
+  else single.close();
 
-  std::cout << " decoder benchmark: " << decoder.mIntegratedBytes << " bytes in " << decoder.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mIntegratedTime << " MB/s"
+  std::cout << " decoder benchmark: " << decoderBytes << " bytes in " << decoderTime << " s"
+	    << " | " << 1.e-6 * decoderBytes / decoderTime << " MB/s"
 	    << std::endl;
+  std::cout << " decoder latency: " << decoderTimer.summary() << std::endl;
+  if (counters) std::cout << " decoder counters: " << decoderCounters.summary() << std::endl;
   
-  std::cout << " checker benchmark: " << decoder.mIntegratedBytes << " bytes in " << checker.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / checker.mIntegratedTime << " MB/s"
-	    << std::endl;
+  if (fused)
+    std::cout << " checker benchmark: fused in the decoder" << std::endl;
+  else {
+    std::cout << " checker benchmark: " << decoderBytes << " bytes in " << checker.mTimer.getTime() << " s"
+	      << " | " << 1.e-6 * decoderBytes / checker.mTimer.getTime() << " MB/s"
+	      << std::endl;
+    std::cout << " checker latency: " << checker.mTimer.summary() << std::endl;
+    if (counters) std::cout << " checker counters: " << checker.mCounters.summary() << std::endl;
+  }
   
-  std::cout << " encoder benchmark: " << encoder.mIntegratedBytes << " bytes in " << encoder.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * encoder.mIntegratedBytes / encoder.mIntegratedTime << " MB/s"
+  std::cout << " encoder benchmark: " << encoder.mIntegratedBytes << " bytes in " << encoder.mTimer.getTime() << " s"
+	    << " | " << 1.e-6 * encoder.mIntegratedBytes / encoder.mTimer.getTime() << " MB/s"
 	    << std::endl;
+  std::cout << " encoder latency: " << encoder.mTimer.summary() << std::endl;
+  if (counters) std::cout << " encoder counters: " << encoder.mCounters.summary() << std::endl;
 
-  std::cout << " local benchmark: " << integratedTime << " s" << std::endl;
+  std::cout << " local benchmark: " << local.getTime() << " s" << std::endl;
+  std::cout << " page latency: " << local.summary() << std::endl;
+
+  auto skipped = demux ? mux.getSkippedBytes() : single.getSkippedBytes();
+  if (skipped)
+    std::cout << " resync: skipped " << skipped << " bytes of corrupted data" << std::endl;
+  if (statistics && report(counts)) return 1;
+  if (cut) {
+    std::cerr << "Error: " << cut << " events cut by the lookahead of " << lookahead << " pages" << std::endl;
+    return 1;
+  }
+  if (demux ? mux.isBad() : single.isBad()) return 1;
   
   return 0;
 }
@@ -0,0 +1,96 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include "Raw/Decoder.h"
+
+/** a raw file decoded from the page cache with and without the EventWords
+    counting of Decoder::setIntegrity, the passes interleaved so that both
+    see the same machine, the fastest pass of each kept **/
+
+/** ns per event of one pass over the file, false if the file cannot be read **/
+static bool
+run(std::string name, bool integrity, double &ns, long &events)
+{
+  tof::data::raw::Decoder decoder;
+  decoder.setSource(tof::data::raw::Source_Mapped);
+  decoder.setIntegrity(integrity);
+  decoder.init();
+  if (decoder.open(name)) return false;
+  /** quiet about the end of the input on every pass **/
+  auto buffer = std::cout.rdbuf(nullptr);
+  events = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  while (!decoder.read()) {
+    decoder.decodeRDH();
+    while (!decoder.decode()) events++;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+  decoder.close();
+  std::cout.rdbuf(buffer);
+  std::cout.clear();
+  ns = events ? 1.e9 * elapsed.count() / events : 0.;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+
+  std::string inFileName;
+  int repeat = 20;
+
+  /** define arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help", "Print help messages")
+    ("input,i", po::value<std::string>(&inFileName)->required(), "Input data file")
+    ("repeat", po::value<int>(&repeat)->default_value(20), "Passes over the file for each setting")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+
+  /** process arguments **/
+  try {
+    /** help **/
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 1;
+    }
+    po::notify(vm);
+  }
+  catch(std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  /** the decoder alone, keep the stage timer out of the way **/
+  tof::data::raw::Timer::setDefaultSampling(1000000);
+
+  /** a first pass to warm the page cache **/
+  double ns, plain = 1.e30, integrity = 1.e30;
+  long events;
+  if (!run(inFileName, false, ns, events)) return 1;
+  if (!events) {
+    std::cerr << "No events in " << inFileName << std::endl;
+    return 1;
+  }
+
+  for (int irepeat = 0; irepeat < repeat; ++irepeat) {
+    run(inFileName, false, ns, events);
+    plain = std::min(plain, ns);
+    run(inFileName, true, ns, events);
+    integrity = std::min(integrity, ns);
+  }
+
+  std::cout << " " << events << " events"
+	    << " | decode " << plain << " ns/event"
+	    << " | integrity " << integrity << " ns/event"
+	    << " | overhead " << 100. * (integrity - plain) / plain << " %"
+	    << std::endl;
+
+  return 0;
+}
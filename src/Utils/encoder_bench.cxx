@@ -0,0 +1,141 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <cstdint>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "Raw/dataFormat.h"
+#include "Compressed/Encoder.h"
+
+/** synthetic TDCs with a growing number of hits, leading hits closed by a
+    trailing hit of their channel later on, a fraction of them left open as
+    noisy channels do, paired by the scan and by the sweep of the Encoder and
+    encoded in full **/
+
+static void
+fill(std::vector<uint32_t> &hits, int nhits, double noise, std::mt19937 &rng)
+{
+  std::uniform_int_distribution<uint32_t> channel(0, 7), time(0, 0x1FFFFF - 0x800), width(1, 0x7ff);
+  std::uniform_real_distribution<double> uniform(0., 1.);
+  std::vector<std::pair<uint32_t, uint32_t>> edges; // time, word
+  while ((int)edges.size() < nhits) {
+    uint32_t Chan = channel(rng) << 21, HitTime = time(rng);
+    edges.push_back({HitTime, 0x1u << 29 | Chan | HitTime});
+    if (uniform(rng) < noise || (int)edges.size() == nhits) continue;
+    HitTime += width(rng);
+    edges.push_back({HitTime, 0x2u << 29 | Chan | HitTime});
+  }
+  std::sort(edges.begin(), edges.end());
+  hits.clear();
+  for (auto &edge : edges) hits.push_back(edge.second);
+}
+
+/** ns per hit over the sample, repeated **/
+template <typename F>
+static double
+run(long nhits, int repeat, F f)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int irepeat = 0; irepeat < repeat; ++irepeat) f();
+  std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+  return 1.e9 * elapsed.count() / repeat / nhits;
+}
+
+int main(int argc, char **argv)
+{
+
+  int tdcs = 256, repeat = 20, max = 1024;
+  double noise = 0.5;
+
+  /** define arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help", "Print help messages")
+    ("tdcs,n", po::value<int>(&tdcs)->default_value(256), "Synthetic TDCs per occupancy")
+    ("repeat", po::value<int>(&repeat)->default_value(20), "Passes over the TDCs")
+    ("max", po::value<int>(&max)->default_value(1024), "Largest number of hits per TDC, up to 1024 for the event to fit the encoder buffer")
+    ("noise", po::value<double>(&noise)->default_value(0.5), "Fraction of leading hits with no trailing hit")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+
+  /** process arguments **/
+  try {
+    /** help **/
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 1;
+    }
+    po::notify(vm);
+  }
+  catch(std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  max = std::min(max, 1024);
+
+  /** the encoder alone, keep the stage timer out of the way **/
+  tof::data::raw::Timer::setDefaultSampling(1000000);
+  tof::data::compressed::Encoder encoder;
+  encoder.init();
+  std::vector<char> output;
+
+  /** a summary with one TDC filled, the event is closed as the decoder would **/
+  tof::data::raw::Summary_t summary = {};
+  summary.DRMGlobalHeader = 0x40000001;
+  summary.DRMGlobalTrailer = 0x50000001;
+  for (int itrm = 0; itrm < 10; ++itrm) summary.TRMempty[itrm] = true;
+  summary.TRMempty[0] = false;
+
+  for (int occupancy = 4; occupancy <= max; occupancy *= 2) {
+
+    /** the same TDCs for all paths **/
+    std::mt19937 rng(12345);
+    std::vector<std::vector<uint32_t>> samples(tdcs);
+    long nhits = 0;
+    for (auto &hits : samples) {
+      fill(hits, occupancy, noise, rng);
+      nhits += hits.size();
+    }
+
+    /** the two pairings agree **/
+    long mismatches = 0;
+    std::vector<uint32_t> totScan(occupancy), totSweep(occupancy);
+    for (auto &hits : samples) {
+      std::fill(totScan.begin(), totScan.end(), 0xffffffff);
+      std::fill(totSweep.begin(), totSweep.end(), 0xffffffff);
+      tof::data::compressed::Encoder::pairScan(hits.data(), hits.size(), totScan.data());
+      tof::data::compressed::Encoder::pair(hits.data(), hits.size(), totSweep.data());
+      if (totScan != totSweep) mismatches++;
+    }
+
+    double scan = run(nhits, repeat, [&]() {
+	for (auto &hits : samples) tof::data::compressed::Encoder::pairScan(hits.data(), hits.size(), totScan.data());
+      });
+    double sweep = run(nhits, repeat, [&]() {
+	for (auto &hits : samples) tof::data::compressed::Encoder::pair(hits.data(), hits.size(), totSweep.data());
+      });
+    double encode = run(nhits, repeat, [&]() {
+	for (auto &hits : samples) {
+	  summary.TDCUnpackedHit = hits;
+	  summary.nTDCUnpackedHits[0][0][0] = hits.size();
+	  encoder.encode(summary);
+	  output.clear();
+	  encoder.flush(output);
+	}
+      });
+    std::cout << " " << occupancy << " hits/TDC"
+	      << " | scan " << scan << " ns/hit"
+	      << " | sweep " << sweep << " ns/hit"
+	      << " | encode " << encode << " ns/hit"
+	      << " | " << mismatches << " mismatches"
+	      << std::endl;
+  }
+
+  return 0;
+}
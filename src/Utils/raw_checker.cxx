@@ -2,15 +2,19 @@
 #include <iostream>
 #include <fstream>
 #include <cstdint>
-#include <chrono>
 #include "Raw/Decoder.h"
 #include "Raw/Checker.h"
+#include "Raw/Indexer.h"
+#include "Raw/Timer.h"
+#include "Raw/Counters.h"
 
 int main(int argc, char **argv)
 {
 
-  bool verbose = false;
-  std::string inFileName, outFileName;
+  bool verbose = false, mmap = false, fused = false, integrity = false;
+  int depth = 0, sample = 1, counters = 0;
+  long event = -1;
+  std::string inFileName, outFileName, indexFileName, statisticsFileName, compareFileName;
   
   /** define arguments **/
   namespace po = boost::program_options;
@@ -19,6 +23,16 @@ int main(int argc, char **argv)
     ("help", "Print help messages")
     ("verbose,v", po::bool_switch(&verbose), "Decode verbose")
     ("input,i", po::value<std::string>(&inFileName), "Input data file")
+    ("mmap", po::bool_switch(&mmap), "Memory-mapped input")
+    ("async", po::value<int>(&depth)->default_value(0), "Read-ahead depth (0 = synchronous)")
+    ("fused", po::bool_switch(&fused), "Check while decoding instead of in a second pass")
+    ("integrity", po::bool_switch(&integrity), "Check DRM/TRM EventWords")
+    ("statistics", po::value<std::string>(&statisticsFileName), "Count the faults by crate, slot and chain, print them and write them to this file")
+    ("compare", po::value<std::string>(&compareFileName), "With --statistics, the statistics file of another run on the same input (e.g. compressed_encoder --statistics) that must match")
+    ("index", po::value<std::string>(&indexFileName), "Event index file (default <input>.idx)")
+    ("sample", po::value<int>(&sample)->default_value(1), "Time one event every N")
+    ("counters", po::value<int>(&counters)->default_value(0), "Read hardware counters every N events (0 = off)")
+    ("event", po::value<long>(&event)->default_value(-1), "Check only this event, verbose, through the index")
     ;
 
   po::variables_map vm;
@@ -44,78 +58,122 @@ int main(int argc, char **argv)
     return 1;
   }
   
+  tof::data::raw::Timer::setDefaultSampling(sample);
+  tof::data::raw::Counters::setDefaultSampling(counters);
+  bool statistics = !statisticsFileName.empty();
   tof::data::raw::Decoder decoder;
   decoder.setVerbose(verbose);
+  decoder.setSource(mmap ? tof::data::raw::Source_Mapped : depth > 0 ? tof::data::raw::Source_Async : tof::data::raw::Source_File);
+  decoder.setDepth(depth);
+  decoder.setCheck(fused);
+  decoder.setIntegrity(integrity);
+  decoder.setStatistics(statistics && fused);
   decoder.init();
   if (decoder.open(inFileName)) return 1;
 
   tof::data::raw::Checker checker;
   checker.setVerbose(verbose);
+  checker.setIntegrity(integrity);
+  checker.setStatistics(statistics && !fused);
+
+  /** single event through the index **/
+  if (event >= 0) {
+    if (indexFileName.empty())
+      indexFileName = tof::data::raw::Indexer::sidecar(inFileName);
+    if (decoder.loadIndex(indexFileName)) return 1;
+    if (decoder.seek(event)) return 1;
+    decoder.setVerbose(true);
+    checker.setVerbose(true);
+    if (decoder.decode()) return 1;
+    bool status = checker.check(decoder.getSummary());
+    decoder.close();
+    return status ? 1 : 0;
+  }
   
-  /** chrono **/
-  std::chrono::time_point<std::chrono::high_resolution_clock> start, finish;
-  std::chrono::duration<double> elapsed;
-  double integratedTime;
+  /** page timer **/
+  tof::data::raw::Timer local;
+  local.setSampling(1);
  
   /** loop over pages **/
   while (!decoder.read()) {
 
-    /** get start chrono **/
-    start = std::chrono::high_resolution_clock::now();	
+    /** start page timer **/
+    auto start = local.start();
     
-    /** decode RDH open **/
+    /** decode RDH **/
     decoder.decodeRDH();
     
     /** decode loop **/
+    long counted = 0;
     while (!decoder.decode()) {
+      counted++;
       
       /** check: if error rewind, print and pause **/
-      if (checker.check(decoder.getSummary())) {
+      if (fused ? decoder.getSummary().checkError : checker.check(decoder.getSummary())) {
+	/** the events up to this one are already counted, the ones after it are counted here **/
 	decoder.rewind();
 	decoder.setVerbose(true);
 	checker.setVerbose(true);
-	decoder.decodeRDH();
-	while (!decoder.decode())
+	for (long ievent = 0; ; ++ievent) {
+	  decoder.setStatistics(statistics && fused && ievent >= counted);
+	  checker.setStatistics(statistics && !fused && ievent >= counted);
+	  if (decoder.decode()) break;
 	  if (checker.check(decoder.getSummary()))
 	    getchar();
+	}
 	decoder.setVerbose(verbose);
+	decoder.setStatistics(statistics && fused);
 	checker.setVerbose(verbose);
+	checker.setStatistics(statistics && !fused);
       }
       
     } /** end of decode loop **/
 
-    /** pause chrono for IO operation **/
-    finish = std::chrono::high_resolution_clock::now();
-    elapsed = finish - start;
-    integratedTime += elapsed.count();
-    
-    /** read page **/
-    decoder.read();
-
-    /** restart chrono after IO operation **/
-    start = std::chrono::high_resolution_clock::now();
-    
-    /** decode RDH close **/
-    decoder.decodeRDH();
-    
-    /** get finish chrono and increment **/
-    finish = std::chrono::high_resolution_clock::now();
-    elapsed = finish - start;
-    integratedTime += elapsed.count();
+    /** stop page timer **/
+    local.stop(start);
     
   } /** end of loop over pages **/
   
   decoder.close();
 
-  std::cout << " decoder benchmark: " << decoder.mIntegratedBytes << " bytes in " << decoder.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mIntegratedTime << " MB/s"
+  std::cout << " decoder benchmark: " << decoder.mIntegratedBytes << " bytes in " << decoder.mTimer.getTime() << " s"
+	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mTimer.getTime() << " MB/s"
 	    << std::endl;
+  std::cout << " decoder latency: " << decoder.mTimer.summary() << std::endl;
+  if (counters) std::cout << " decoder counters: " << decoder.mCounters.summary() << std::endl;
   
-  std::cout << " checker benchmark: " << decoder.mIntegratedBytes << " bytes in " << checker.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / checker.mIntegratedTime << " MB/s"
-	    << std::endl;
+  if (fused)
+    std::cout << " checker benchmark: fused in the decoder" << std::endl;
+  else {
+    std::cout << " checker benchmark: " << decoder.mIntegratedBytes << " bytes in " << checker.mTimer.getTime() << " s"
+	      << " | " << 1.e-6 * decoder.mIntegratedBytes / checker.mTimer.getTime() << " MB/s"
+	      << std::endl;
+    std::cout << " checker latency: " << checker.mTimer.summary() << std::endl;
+    if (counters) std::cout << " checker counters: " << checker.mCounters.summary() << std::endl;
+  }
   
-  std::cout << " local benchmark: " << integratedTime << " s" << std::endl;
+  std::cout << " local benchmark: " << local.getTime() << " s" << std::endl;
+  std::cout << " page latency: " << local.summary() << std::endl;
+
+  if (decoder.getSkippedBytes())
+    std::cout << " resync: skipped " << decoder.getSkippedBytes() << " bytes of corrupted data" << std::endl;
+
+  if (statistics) {
+    auto &counts = fused ? decoder.getStatistics() : checker.getStatistics();
+    std::cout << " run statistics: " << statisticsFileName << std::endl;
+    counts.print(std::cout);
+    if (counts.write(statisticsFileName)) return 1;
+    if (!compareFileName.empty()) {
+      tof::data::raw::Statistics other;
+      if (other.read(compareFileName)) return 1;
+      if (!(counts == other)) {
+	std::cerr << "Error: statistics differ from " << compareFileName << std::endl;
+	return 1;
+      }
+      std::cout << " statistics match " << compareFileName << std::endl;
+    }
+  }
+  if (decoder.isBad()) return 1;
   
   return 0;
 }
@@ -38,7 +38,8 @@ uint32_t current = 0;
 int main(int argc, char **argv)
 {
 
-  bool verbose = false;
+  bool verbose = false, mmap = false;
+  int depth = 0;
   std::string inFileName;
   
   /** define arguments **/
@@ -47,7 +48,9 @@ int main(int argc, char **argv)
   desc.add_options()
     ("help", "Print help messages")
     ("verbose,v", po::bool_switch(&verbose), "Decode verbose")
-    ("input,i", po::value<std::string>(&inFileName), "Input data file")
+    ("input,i", po::value<std::string>(&inFileName), "Input data file, - for stdin, unix:<path> for socket")
+    ("mmap", po::bool_switch(&mmap), "Memory-mapped input")
+    ("async", po::value<int>(&depth)->default_value(0), "Read-ahead depth (0 = synchronous)")
     ("word,w",  po::value<int>(&wordn)->default_value(2), "Word where to find the data")
     ;
   /** positional arguments **/
@@ -71,6 +74,8 @@ int main(int argc, char **argv)
   
   Decoder decoder;
   decoder.setVerbose(verbose);
+  decoder.setSource(mmap ? tof::data::raw::Source_Mapped : depth > 0 ? tof::data::raw::Source_Async : tof::data::raw::Source_File);
+  decoder.setDepth(depth);
   decoder.init();
   decoder.open(inFileName);
 
@@ -78,16 +83,14 @@ int main(int argc, char **argv)
     decoder.decodeRDH();
     for (int i = 0; i < 3; ++i)
       if (decoder.decode()) break;
-    decoder.read();
-    decoder.decodeRDH();
   }
 
   decoder.close();
   
   return 0;
 
-  std::cout << " benchmark: decoded " << 1.e-6 * decoder.mIntegratedBytes << " MB in " << decoder.mIntegratedTime << " s"
-	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mIntegratedTime << " MB/s"
+  std::cout << " benchmark: decoded " << 1.e-6 * decoder.mIntegratedBytes << " MB in " << decoder.mTimer.getTime() << " s"
+	    << " | " << 1.e-6 * decoder.mIntegratedBytes / decoder.mTimer.getTime() << " MB/s"
 	    << std::endl;
 
 
@@ -15,11 +15,79 @@ const double BC_FREQUENCY = 40.07897e6; // [Hz]
 const double BC_WIDTH = 1.e6 / BC_FREQUENCY; // [us]
 const double TDC_BIN_WIDTH = BC_WIDTH / 1024.; // [us]
 
+/** visitor filling the histograms directly from the decode stream **/
+
+struct HistogramVisitor : public tof::data::raw::Visitor
+{
+  uint32_t latencyWindow;
+  uint32_t DRM_L0BCID;
+  int windowStart;
+  uint32_t DRMGlobalTrailer;
+  uint32_t TRMGlobalHeader[10];
+  TH1 *hDRM_L0BCID, *hDRM_LocalEventCounter, *hCrate_Channel, *hTDC_HitTime, *hTDC_HitTime_us, *hOrbit_Time, *hOrbit_Time_us;
+  TH2 *hTRM_EventNumber, *hTRM_EventWords, *hTRM_TDCID;
+  std::map<uint32_t, TH1 *> mapBC_Orbit_Time;
+  std::map<uint32_t, TH1 *> mapBC_Orbit_Time_us;
+
+  void onEventBegin() {
+    DRMGlobalTrailer = 0x0;
+    for (int itrm = 0; itrm < 10; ++itrm)
+      TRMGlobalHeader[itrm] = 0x0;
+  };
+
+  void onDRMHeader(const uint32_t *words) {
+    DRM_L0BCID = GET_DRM_L0BCID(words[5]);
+    windowStart = (DRM_L0BCID - latencyWindow) * 1024;
+    hDRM_L0BCID->Fill(DRM_L0BCID);
+    if (!mapBC_Orbit_Time.count(DRM_L0BCID))
+      mapBC_Orbit_Time[DRM_L0BCID] = new TH1F(Form("hOrbit_Time_BC%d", DRM_L0BCID), "", 8192, 0., N_ORBIT_TDC_BINS);
+    if (!mapBC_Orbit_Time_us.count(DRM_L0BCID))
+      mapBC_Orbit_Time_us[DRM_L0BCID] = new TH1F(Form("hOrbit_Time_us_BC%d", DRM_L0BCID), "", 8192, 0., N_ORBIT_BC * BC_WIDTH);
+  };
+
+  void onTRMHeader(int itrm, uint32_t word) {TRMGlobalHeader[itrm] = word;};
+
+  void onDRMTrailer(uint32_t word) {DRMGlobalTrailer = word;};
+
+  void onEventEnd() {
+    hDRM_LocalEventCounter->Fill(GET_DRM_LOCALEVENTCOUNTER(DRMGlobalTrailer));
+    for (int itrm = 0; itrm < 10; ++itrm) {
+      hTRM_EventNumber->Fill(itrm, GET_TRM_EVENTNUMBER(TRMGlobalHeader[itrm]));
+      hTRM_EventWords->Fill(itrm, GET_TRM_EVENTWORDS(TRMGlobalHeader[itrm]));
+    }
+  };
+  
+  void onHit(int itrm, int ichain, uint32_t hit) {
+    auto PSBits = GET_TDCHIT_PSBITS(hit);
+    if (PSBits != 0x1) return;
+    auto TDC_HitTime = GET_TDCHIT_HITTIME(hit);
+    auto TDCID = GET_TDCHIT_TDCID(hit);
+    if (TDCID > 14) return;
+    auto Chan = GET_TDCHIT_CHAN(hit);
+    auto index = Chan + 8 * TDCID + 120 * ichain + 240 * itrm;
+    hTRM_TDCID->Fill(itrm, TDCID + 15 * ichain);
+    hCrate_Channel->Fill(index);
+    hTDC_HitTime->Fill(TDC_HitTime);
+    hTDC_HitTime_us->Fill(TDC_HitTime * TDC_BIN_WIDTH);
+    if (TDC_HitTime < 4096) return;
+    int Orbit_Time = windowStart + TDC_HitTime;
+    if (Orbit_Time < 0) {
+      Orbit_Time += N_ORBIT_BC * 1024;
+    }
+    hOrbit_Time->Fill(Orbit_Time);
+    hOrbit_Time_us->Fill(Orbit_Time * TDC_BIN_WIDTH);
+    mapBC_Orbit_Time[DRM_L0BCID]->Fill(Orbit_Time);
+    mapBC_Orbit_Time_us[DRM_L0BCID]->Fill(Orbit_Time * TDC_BIN_WIDTH);
+  };
+  
+};
+
 int main(int argc, char **argv)
 {
 
-  bool verbose = false;
+  bool verbose = false, mmap = false;
   std::string inFileName, outFileName;
+  int depth = 0;
   uint32_t spacingWindow, matchingWindow, latencyWindow;
   
   /** define arguments **/
@@ -29,6 +97,8 @@ int main(int argc, char **argv)
     ("help"                                                                   , "Print help messages")
     ("verbose,v"  , po::bool_switch(&verbose)                                 , "Decode verbose")
     ("input,i"    , po::value<std::string>(&inFileName)->required()           , "Input data file")
+    ("mmap"       , po::bool_switch(&mmap)                                    , "Memory-mapped input")
+    ("async"      , po::value<int>(&depth)->default_value(0)                  , "Read-ahead depth (0 = synchronous)")
     ("output,o"   , po::value<std::string>(&outFileName)->required()          , "Output data file")
     ("spacing,s"  , po::value<uint32_t>(&spacingWindow)->default_value(1188)  , "Spacing window (BC)")
     ("matching,m" , po::value<uint32_t>(&matchingWindow)->default_value(1192) , "Matching window (BC)")
@@ -62,6 +132,8 @@ int main(int argc, char **argv)
   
   tof::data::raw::Decoder decoder;
   decoder.setVerbose(verbose);
+  decoder.setSource(mmap ? tof::data::raw::Source_Mapped : depth > 0 ? tof::data::raw::Source_Async : tof::data::raw::Source_File);
+  decoder.setDepth(depth);
   decoder.init();
   if (decoder.open(inFileName)) return 1;
 
@@ -78,74 +150,35 @@ int main(int argc, char **argv)
   auto hTRM_TDCID = new TH2F("hTRM_TDCID", "", 10, 0., 10., 30, 0., 30.);
   
   auto h2 = new TH2F("h2", "", N_ORBIT_BC, 0., N_ORBIT_BC, 8192, 0., N_ORBIT_TDC_BINS);
-  
-  std::map<uint32_t, TH1 *> mapBC_Orbit_Time;
-  std::map<uint32_t, TH1 *> mapBC_Orbit_Time_us;
+
+  HistogramVisitor histogrammer;
+  histogrammer.latencyWindow = latencyWindow;
+  histogrammer.hDRM_L0BCID = hDRM_L0BCID;
+  histogrammer.hDRM_LocalEventCounter = hDRM_LocalEventCounter;
+  histogrammer.hTRM_EventNumber = hTRM_EventNumber;
+  histogrammer.hTRM_EventWords = hTRM_EventWords;
+  histogrammer.hCrate_Channel = hCrate_Channel;
+  histogrammer.hTDC_HitTime = hTDC_HitTime;
+  histogrammer.hTDC_HitTime_us = hTDC_HitTime_us;
+  histogrammer.hOrbit_Time = hOrbit_Time;
+  histogrammer.hOrbit_Time_us = hOrbit_Time_us;
+  histogrammer.hTRM_TDCID = hTRM_TDCID;
+  auto &mapBC_Orbit_Time = histogrammer.mapBC_Orbit_Time;
+  auto &mapBC_Orbit_Time_us = histogrammer.mapBC_Orbit_Time_us;
   
   /** loop over pages **/
   while (!decoder.read()) {
     
-    /** decode RDH open **/
+    /** decode RDH **/
     decoder.decodeRDH();
     
     hRDH_MemorySize->Fill(decoder.getSummary().RDHWord0.MemorySize);
     
-    /** decode loop **/
-    while (!decoder.decode()) {
-
-      auto summary = decoder.getSummary();
-      uint32_t DRM_L0BCID = GET_DRM_L0BCID(summary.DRMStatusHeader3);
-      uint32_t DRM_LocalEventCounter = GET_DRM_LOCALEVENTCOUNTER(summary.DRMGlobalTrailer);
-      int windowStart = (DRM_L0BCID - latencyWindow) * 1024;
-
-      hDRM_L0BCID->Fill(DRM_L0BCID);
-      hDRM_LocalEventCounter->Fill(DRM_LocalEventCounter);
-      
-      if (!mapBC_Orbit_Time.count(DRM_L0BCID))
-	mapBC_Orbit_Time[DRM_L0BCID] = new TH1F(Form("hOrbit_Time_BC%d", DRM_L0BCID), "", 8192, 0., N_ORBIT_TDC_BINS);
-      if (!mapBC_Orbit_Time_us.count(DRM_L0BCID))
-	mapBC_Orbit_Time_us[DRM_L0BCID] = new TH1F(Form("hOrbit_Time_us_BC%d", DRM_L0BCID), "", 8192, 0., N_ORBIT_BC * BC_WIDTH);
-      
-      for (int itrm = 0; itrm < 10; ++itrm) {
-
-	hTRM_EventNumber->Fill(itrm, GET_TRM_EVENTNUMBER(summary.TRMGlobalHeader[itrm]));
-	hTRM_EventWords->Fill(itrm, GET_TRM_EVENTWORDS(summary.TRMGlobalHeader[itrm]));
-	
-	for (int ichain = 0; ichain < 2; ++ichain) {
-	  for (int itdc = 0; itdc < 15; ++itdc) {
-	    for (int ihit = 0; ihit < summary.nTDCUnpackedHits[itrm][ichain][itdc]; ++ihit) {
-	      auto PSBits = GET_TDCHIT_PSBITS(summary.TDCUnpackedHit[itrm][ichain][itdc][ihit]);
-	      if (PSBits != 0x1) continue;
-	      auto TDC_HitTime = GET_TDCHIT_HITTIME(summary.TDCUnpackedHit[itrm][ichain][itdc][ihit]);
-	      auto TDCID = GET_TDCHIT_TDCID(summary.TDCUnpackedHit[itrm][ichain][itdc][ihit]);
-	      auto Chan = GET_TDCHIT_CHAN(summary.TDCUnpackedHit[itrm][ichain][itdc][ihit]);
-	      auto index = Chan + 8 * TDCID + 120 * ichain + 240 * itrm;
-	      hTRM_TDCID->Fill(itrm, itdc + 15 * ichain);
-	      hCrate_Channel->Fill(index);
-	      hTDC_HitTime->Fill(TDC_HitTime);
-	      hTDC_HitTime_us->Fill(TDC_HitTime * TDC_BIN_WIDTH);
-	      if (TDC_HitTime < 4096) continue;
-	      int Orbit_Time = windowStart + TDC_HitTime;
-	      if (Orbit_Time < 0) {
-		Orbit_Time += N_ORBIT_BC * 1024;
-	      }
-	      hOrbit_Time->Fill(Orbit_Time);
-	      hOrbit_Time_us->Fill(Orbit_Time * TDC_BIN_WIDTH);
-	      mapBC_Orbit_Time[DRM_L0BCID]->Fill(Orbit_Time);
-	      mapBC_Orbit_Time_us[DRM_L0BCID]->Fill(Orbit_Time * TDC_BIN_WIDTH);
-	    }
-	  }
-	}
-      }
-      
+    /** decode loop, histograms are filled as the words stream by **/
+    while (!decoder.decode(histogrammer)) {
+
     } /** end of decode loop **/
     
-    /** read page **/
-    decoder.read();
-    
-    /** decode RDH close **/
-    decoder.decodeRDH();
-    
   } /** end of loop over pages **/
   
   
@@ -0,0 +1,72 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <chrono>
+#include "Raw/Indexer.h"
+
+int main(int argc, char **argv)
+{
+
+  bool verbose = false, dump = false;
+  std::string inFileName, outFileName;
+  
+  /** define arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help", "Print help messages")
+    ("verbose,v", po::bool_switch(&verbose), "Index verbose")
+    ("input,i", po::value<std::string>(&inFileName), "Input data file")
+    ("output,o", po::value<std::string>(&outFileName), "Output index file (default <input>.idx)")
+    ("dump", po::bool_switch(&dump), "Print index entries")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  
+  /** process arguments **/
+  try {
+    /** help **/
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 1;
+    }
+    po::notify(vm);
+  }
+  catch(std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  if (inFileName.empty()) {
+    std::cout << desc << std::endl;
+    return 1;
+  }
+  if (outFileName.empty())
+    outFileName = tof::data::raw::Indexer::sidecar(inFileName);
+  
+  tof::data::raw::Indexer indexer;
+  indexer.setVerbose(verbose);
+
+  auto start = std::chrono::high_resolution_clock::now();
+  if (indexer.build(inFileName)) return 1;
+  auto finish = std::chrono::high_resolution_clock::now();
+  std::chrono::duration<double> elapsed = finish - start;
+  
+  if (indexer.write(outFileName)) return 1;
+
+  auto &index = indexer.getIndex();
+  if (dump) {
+    for (size_t ievent = 0; ievent < index.size(); ++ievent) {
+      auto &entry = index[ievent];
+      printf(" event %zu: offset=%lu page=%u word=%u length=%u FeeID=%u orbit=%u L0BCID=%u \n", ievent,
+	     (unsigned long)entry.Offset, entry.Page, entry.Word, entry.Length, entry.FeeID, entry.Orbit, entry.L0BCID);
+    }
+  }
+  
+  std::cout << " indexer benchmark: " << index.size() << " events in " << elapsed.count() << " s" << std::endl;
+  
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include "Raw/Scheduler.h"
+
+/** synthetic skewed load: every crate queues its events, in order, on its home worker,
+    the event cost falls with the crate rank as a power law. The crate is the key, its
+    events run one at a time in order wherever they are stolen **/
+
+static void
+spin(double seconds, bool sleep)
+{
+  /** sleeping keeps the workers apart when there are fewer cores than workers **/
+  if (sleep) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    return;
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+  while (std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() < seconds);
+}
+
+static double
+run(int threads, int crates, int events, double cost, double skew, bool sleep, bool stealing, long &violations)
+{
+  tof::data::raw::Scheduler scheduler;
+  scheduler.setStealing(stealing);
+  scheduler.start(threads);
+
+  /** events of a crate that run before an earlier one **/
+  std::vector<long> last(crates, -1);
+  std::mutex mutex;
+  violations = 0;
+
+  std::mt19937 rng(12345);
+  std::exponential_distribution<double> jitter(1.);
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int ievent = 0; ievent < events; ++ievent) {
+    for (int icrate = 0; icrate < crates; ++icrate) {
+      double seconds = 1.e-6 * cost * std::pow(icrate + 1., -skew) * jitter(rng);
+      scheduler.push([&, icrate, ievent, seconds] (int) {
+	  spin(seconds, sleep);
+	  std::lock_guard<std::mutex> lock(mutex);
+	  if (ievent != last[icrate] + 1) violations++;
+	  last[icrate] = ievent;
+	}, icrate % threads, icrate);
+    }
+  }
+  scheduler.wait();
+  std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+  /** utilisation of every worker over the makespan **/
+  double busy = 0., maxbusy = 0.;
+  for (int i = 0; i < threads; ++i) {
+    std::cout << "   worker " << i << ": " << scheduler.getExecuted(i) << " tasks, " << scheduler.getStolen(i) << " stolen"
+	      << " | " << 100. * scheduler.getBusyTime(i) / elapsed.count() << "% busy"
+	      << std::endl;
+    busy += scheduler.getBusyTime(i);
+    if (scheduler.getBusyTime(i) > maxbusy) maxbusy = scheduler.getBusyTime(i);
+  }
+  std::cout << "   makespan " << elapsed.count() << " s"
+	    << " | utilisation " << 100. * busy / threads / elapsed.count() << "%"
+	    << " | balance (mean/max busy) " << busy / threads / maxbusy
+	    << std::endl;
+  scheduler.stop();
+  return elapsed.count();
+}
+
+int main(int argc, char **argv)
+{
+
+  int threads = 4, crates = 72, events = 100;
+  double cost = 2000., skew = 1.;
+  bool sleep = false;
+  
+  /** define arguments **/
+  namespace po = boost::program_options;
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help", "Print help messages")
+    ("threads,j", po::value<int>(&threads)->default_value(4), "Worker threads")
+    ("crates,c", po::value<int>(&crates)->default_value(72), "Number of crates")
+    ("events,n", po::value<int>(&events)->default_value(100), "Events per crate")
+    ("cost", po::value<double>(&cost)->default_value(2000.), "Cost of an event of the hottest crate (us)")
+    ("skew", po::value<double>(&skew)->default_value(1.), "Power-law exponent of the cost versus crate rank")
+    ("sleep", po::bool_switch(&sleep), "Sleep instead of spinning for the event cost")
+    ;
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  
+  /** process arguments **/
+  try {
+    /** help **/
+    if (vm.count("help")) {
+      std::cout << desc << std::endl;
+      return 1;
+    }
+    po::notify(vm);
+  }
+  catch(std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  /** spinning workers share the cores and the busy times measure the machine, not the schedule **/
+  if (!sleep && std::thread::hardware_concurrency() < (unsigned int)threads + 1) {
+    std::cout << "Warning: " << std::thread::hardware_concurrency() << " cores for " << threads
+	      << " workers and the producer, sleeping for the event cost" << std::endl;
+    sleep = true;
+  }
+
+  long violations, total = 0;
+  std::cout << " static partitioning by crate:" << std::endl;
+  double tstatic = run(threads, crates, events, cost, skew, sleep, false, violations);
+  total += violations;
+  std::cout << " work stealing:" << std::endl;
+  double tsteal = run(threads, crates, events, cost, skew, sleep, true, violations);
+  total += violations;
+  std::cout << "   " << total << " events run out of order within their crate" << std::endl;
+  std::cout << " speedup of work stealing: " << tstatic / tsteal << std::endl;
+  
+  return total > 0;
+}